@@ -120,9 +120,62 @@ static char Rcs_Id[] =
 #include <ctype.h>
 #include <sys/stat.h>
 
+/*
+** A derivation of a word for the full-form table, as collected by
+** expandroot before the table is laid out.
+*/
+struct fullrec
+    {
+    unsigned char *	word;		/* Derived word, as a string */
+    unsigned int	ent;		/* Index of root in hashtbl */
+    unsigned short	prefix;		/* Index in pflaglist, or NOAFFIX */
+    unsigned short	suffix;		/* Index in sflaglist, or NOAFFIX */
+    };
+
 int		main P ((int argc, char * argv[]));
 static void	output P ((void));
 static void	filltable P ((void));
+static void	placeword P ((struct dent * wp, struct dent * ndp,
+		  struct dent ** nextvarp));
+static void	buildindex P ((struct flagent * list, unsigned int lo,
+		  unsigned int hi, int depth, int suffix, unsigned int node));
+static ichar_t	affixchar P ((struct flagent * entry, int depth,
+		  int suffix));
+static unsigned int
+		writeindex P ((FILE * houtfile, struct flagent * list,
+		  unsigned int nflags, int suffix));
+static unsigned int
+		writebuckets P ((FILE * houtfile));
+static unsigned int
+		buildmph P ((unsigned int ** dispp, struct mphent ** tblp,
+		  unsigned int * nslotsp));
+static char *	findroots P ((unsigned int * nwordsp));
+static unsigned int
+		writefull P ((FILE * houtfile));
+static void	expandroot P ((unsigned int ent));
+static int	pfxapplies P ((struct flagent * flent, ichar_t * root, int len,
+		  ichar_t * word));
+static int	sfxapplies P ((struct flagent * flent, ichar_t * root, int len,
+		  ichar_t * word));
+static void	addfullform P ((ichar_t * word, unsigned int ent,
+		  unsigned int prefix, unsigned int suffix));
+static int	fullcmp P ((struct fullrec * a, struct fullrec * b));
+static void	expandall P ((void));
+static unsigned int
+		writenear P ((FILE * houtfile));
+static unsigned int
+		writetrie P ((FILE * houtfile));
+static unsigned char **
+		findforms P ((unsigned int * nforms));
+static int	formcmp P ((unsigned char ** a, unsigned char ** b));
+static unsigned int
+		findmask P ((struct dent * dp));
+static unsigned long
+		writepacked P ((FILE * houtfile, struct hashdent * hents,
+		  unsigned long strptr));
+static int	revcmp P ((unsigned int * enta, unsigned int * entb));
+static unsigned int
+		writebloom P ((FILE * houtfile));
 VOID *		mymalloc P ((unsigned int size));
 VOID *		myrealloc P ((VOID * ptr, unsigned int size,
 		  unsigned int oldsize));
@@ -132,6 +185,8 @@ static unsigned int
 		newcount P ((void));
 
 #define NSTAT	100		/* Size probe-statistics table */
+#define MPHMAXTRIES 0x1000000	/* Most displacements to try per group */
+#define MASKHASHSIZE (2 * MAXHASHMASKS) /* Size of mask-finding table */
 
 char *		Dfile;		/* Name of dictionary file */
 char *		Hfile;		/* Name of hash (output) file */
@@ -140,6 +195,22 @@ char *		Lfile;		/* Name of language file */
 char		Sfile[MAXPATHLEN]; /* Name of statistics file */
 
 static int silent = 0;		/* NZ to suppress count reports */
+static int bucketed = 0;	/* NZ to write a bucketed hash index */
+static int perfect = 0;		/* NZ to write a perfect hash index */
+static int packed = 0;		/* NZ to pack the words */
+static int fullform = 0;	/* NZ to write a full-form table */
+static int nearmiss = 0;	/* NZ to write a near-miss index */
+static int trie = 0;		/* NZ to write a trie of all words */
+static unsigned int nvariants;	/* No. of variants after hash table */
+static unsigned int nmasks;	/* No. of masks in hashmasks */
+static unsigned int * maskhash;	/* Hash of hashmasks, for findmask */
+static unsigned char ** packedents; /* Packed words, for revcmp */
+static struct affixnode * flagindex; /* Index being built */
+static unsigned int indexsize;	/* No. of nodes in flagindex */
+
+static struct fullrec * fullrecs;	/* Derivations found so far */
+static unsigned int nfullrecs;	/* Number of entries in fullrecs */
+static unsigned int fullrecsize; /* Space available in fullrecs */
 
 int main (argc, argv)
     int		argc;
@@ -161,6 +232,24 @@ int main (argc, argv)
 	    case 's':
 		silent = 1;
 		break;
+	    case 'b':
+		bucketed = 1;
+		break;
+	    case 'p':
+		perfect = 1;
+		break;
+	    case 'z':
+		packed = 1;
+		break;
+	    case 'f':
+		fullform = 1;
+		break;
+	    case 'n':
+		nearmiss = 1;
+		break;
+	    case 't':
+		trie = 1;
+		break;
 	    }
 	}
     if (argc == 4)
@@ -255,12 +344,16 @@ static void output ()
     {
     register FILE *		houtfile;
     register struct dent *	dp;
+    struct hashdent *		hdp;
+    struct hashdent *		hents;
     unsigned long		strptr;
     int				n;
     unsigned int		i;
     int				maxplen;
     int				maxslen;
     struct flagent *		fentry;
+    unsigned int *		mphdisps;
+    struct mphent *		mphtbl;
 
     if ((houtfile = fopen (Hfile, "wb")) == NULL)
 	{
@@ -271,32 +364,15 @@ static void output ()
     hashheader.lstringsize = 0;
     hashheader.tblsize = hashsize;
     (void) fwrite ((char *) &hashheader, sizeof hashheader, 1, houtfile);
+    hashheader.stringstart = sizeof hashheader;
     strptr = 0;
     /*
-    ** Put out the strings from the flags table.  This code assumes that
-    ** the size of the hash header is a multiple of the size of ichar_t,
-    ** and that any long can be converted to an (ichar_t *) and back
-    ** without damage (or, more accurately, without damaging those
-    ** low-order bits necessary to represent the largest offset in the
-    ** string table).
+    ** Find the longest change made by any one affix.  The affix strings
+    ** themselves are carried in the flag entries.
     */
     maxslen = 0;
     for (i = 0, fentry = sflaglist;  i < numsflags;  i++, fentry++)
 	{
-	if (fentry->stripl)
-	    {
-	    (void) fwrite ((char *) fentry->strip, fentry->stripl + 1,
-	      sizeof (ichar_t), houtfile);
-	    fentry->strip = (ichar_t *) strptr;
-	    strptr += (fentry->stripl + 1) * sizeof (ichar_t);
-	    }
-	if (fentry->affl)
-	    {
-	    (void) fwrite ((char *) fentry->affix, fentry->affl + 1,
-	      sizeof (ichar_t), houtfile);
-	    fentry->affix = (ichar_t *) strptr;
-	    strptr += (fentry->affl + 1) * sizeof (ichar_t);
-	    }
 	n = fentry->affl - fentry->stripl;
 	if (n < 0)
 	    n = -n;
@@ -306,20 +382,6 @@ static void output ()
     maxplen = 0;
     for (i = 0, fentry = pflaglist;  i < numpflags;  i++, fentry++)
 	{
-	if (fentry->stripl)
-	    {
-	    (void) fwrite ((char *) fentry->strip, fentry->stripl + 1,
-	      sizeof (ichar_t), houtfile);
-	    fentry->strip = (ichar_t *) strptr;
-	    strptr += (fentry->stripl + 1) * sizeof (ichar_t);
-	    }
-	if (fentry->affl)
-	    {
-	    (void) fwrite ((char *) fentry->affix, fentry->affl + 1,
-	      sizeof (ichar_t), houtfile);
-	    fentry->affix = (ichar_t *) strptr;
-	    strptr += (fentry->affl + 1) * sizeof (ichar_t);
-	    }
 	n = fentry->affl - fentry->stripl;
 	if (n < 0)
 	    n = -n;
@@ -357,104 +419,1484 @@ static void output ()
 	  BHASH_C_BAFF_1 (MAXAFFIXLEN, maxslen - MAXAFFIXLEN));
 	(void) fprintf (stderr, BHASH_C_BAFF_2);
 	}
-    /* Put out the dictionary strings */
-    for (i = 0, dp = hashtbl;  i < hashsize;  i++, dp++)
+    /*
+    ** Build the file version of the hash table while putting out the
+    ** dictionary strings.
+    */
+    hents = (struct hashdent *)
+      calloc ((unsigned) (hashsize + nvariants), sizeof *hents);
+    hashmasks = (struct hashmask *)
+      calloc ((unsigned) MAXHASHMASKS, sizeof (struct hashmask));
+    maskhash = (unsigned int *)
+      calloc ((unsigned) MASKHASHSIZE, sizeof (unsigned int));
+    if (hents == NULL  ||  hashmasks == NULL  ||  maskhash == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    nmasks = 0;
+    for (i = 0, dp = hashtbl, hdp = hents;
+      i < hashsize + nvariants;
+      i++, dp++, hdp++)
 	{
 	if (dp->word == NULL)
-	    dp->word = (unsigned char *) -1;
+	    hdp->word = NOWORD;
 	else
 	    {
-	    n = strlen ((char *) dp->word) + 1;
-	    (void) fwrite (dp->word, n, 1, houtfile);
-	    dp->word = (unsigned char *) strptr;
-	    strptr += n;
+	    if (!packed)
+		{
+		n = strlen ((char *) dp->word) + 1;
+		(void) fwrite (dp->word, n, 1, houtfile);
+		hdp->word = strptr;
+		strptr += n;
+		}
+	    hdp->fprint = hashfprint (strtosichar (dp->word, 1));
 	    }
+	if (dp->next != NULL)
+	    hdp->next = dp->next - hashtbl;
+	else
+	    hdp->next = NOENTRY;
+	hdp->maskno = findmask (dp);
 	}
-    /* Pad file to a struct dent boundary for efficiency. */
-    n = (strptr + sizeof hashheader) % sizeof (struct dent);
+    free ((char *) maskhash);
+    hashheader.packedwords = packed;
+    if (packed)
+	strptr = writepacked (houtfile, hents, strptr);
+    /* Pad the strings so the hash table is properly aligned. */
+    n = (strptr + sizeof hashheader) % sizeof (struct hashdent);
     if (n != 0)
 	{
-	n = sizeof (struct dent) - n;
+	n = sizeof (struct hashdent) - n;
 	strptr += n;
 	while (--n >= 0)
 	    (void) putc ('\0', houtfile);
 	}
+    hashheader.stringsize = strptr;
+    hashheader.tblstart = hashheader.stringstart + strptr;
     /* Put out the hash table itself */
-    for (i = 0, dp = hashtbl;  i < hashsize;  i++, dp++)
-	{
-	if (dp->next != 0)
-	    {
-	    unsigned long	x;
-	    x = dp->next - hashtbl;
-	    dp->next = (struct dent *)x;
-	    }
-	else
-	    {
-	    dp->next = (struct dent *)-1;
-	    }
 #ifdef PIECEMEAL_HASH_WRITES
-	(void) fwrite ((char *) dp, sizeof (struct dent), 1, houtfile);
+    for (i = 0, hdp = hents;  i < hashsize + nvariants;  i++, hdp++)
+	(void) fwrite ((char *) hdp, sizeof (struct hashdent), 1, houtfile);
+#else /* PIECEMEAL_HASH_WRITES */
+    (void) fwrite ((char *) hents, sizeof (struct hashdent),
+      hashsize + nvariants, houtfile);
 #endif /* PIECEMEAL_HASH_WRITES */
+    free ((char *) hents);
+    hashheader.nvariants = nvariants;
+    /* Put out the masks the entries refer to, properly aligned */
+    hashheader.maskstart =
+      hashheader.tblstart + (hashsize + nvariants) * sizeof (struct hashdent);
+    n = hashheader.maskstart % sizeof (struct hashmask);
+    if (n != 0)
+	{
+	n = sizeof (struct hashmask) - n;
+	hashheader.maskstart += n;
+	while (--n >= 0)
+	    (void) putc ('\0', houtfile);
 	}
-#ifndef PIECEMEAL_HASH_WRITES
-    (void) fwrite ((char *) hashtbl, sizeof (struct dent), hashsize, houtfile);
-#endif /* PIECEMEAL_HASH_WRITES */
+    (void) fwrite ((char *) hashmasks, sizeof (struct hashmask), nmasks,
+      houtfile);
+    free ((char *) hashmasks);
+    hashheader.nmasks = nmasks;
     /* Put out the language tables */
+    hashheader.flagstart =
+      hashheader.maskstart + nmasks * sizeof (struct hashmask);
     (void) fwrite ((char *) sflaglist,
       sizeof (struct flagent), numsflags, houtfile);
     hashheader.stblsize = numsflags;
     (void) fwrite ((char *) pflaglist,
       sizeof (struct flagent), numpflags, houtfile);
     hashheader.ptblsize = numpflags;
+    /* Put out the flag indexes, aligned after the flag tables */
+    hashheader.sindexstart = hashheader.flagstart
+      + (numsflags + numpflags) * sizeof (struct flagent);
+    n = hashheader.sindexstart % sizeof (struct affixnode);
+    if (n != 0)
+	{
+	n = sizeof (struct affixnode) - n;
+	hashheader.sindexstart += n;
+	while (--n >= 0)
+	    (void) putc ('\0', houtfile);
+	}
+    hashheader.pindexstart = hashheader.sindexstart
+      + writeindex (houtfile, sflaglist, numsflags, 1);
+    hashheader.filesize = hashheader.pindexstart
+      + writeindex (houtfile, pflaglist, numpflags, 0);
+    /* Put out the bucketed index, if wanted, aligned to a cache line */
+    hashheader.bucketstart = 0;
+    hashheader.nbuckets = 0;
+    if (bucketed)
+	{
+	n = hashheader.filesize % sizeof (struct hashbucket);
+	if (n != 0)
+	    {
+	    n = sizeof (struct hashbucket) - n;
+	    hashheader.filesize += n;
+	    while (--n >= 0)
+		(void) putc ('\0', houtfile);
+	    }
+	hashheader.bucketstart = hashheader.filesize;
+	hashheader.nbuckets = writebuckets (houtfile);
+	hashheader.filesize +=
+	  hashheader.nbuckets * sizeof (struct hashbucket);
+	}
+    /* Put out the perfect hash, if wanted and we can find one */
+    hashheader.mphstart = 0;
+    hashheader.nmphdisps = 0;
+    hashheader.nmphslots = 0;
+    if (perfect)
+	hashheader.nmphdisps =
+	  buildmph (&mphdisps, &mphtbl, &hashheader.nmphslots);
+    if (hashheader.nmphdisps != 0)
+	{
+	n = hashheader.filesize % sizeof (struct mphent);
+	if (n != 0)
+	    {
+	    n = sizeof (struct mphent) - n;
+	    hashheader.filesize += n;
+	    while (--n >= 0)
+		(void) putc ('\0', houtfile);
+	    }
+	hashheader.mphstart = hashheader.filesize;
+	(void) fwrite ((char *) mphdisps, sizeof (unsigned int),
+	  hashheader.nmphdisps, houtfile);
+	(void) fwrite ((char *) mphtbl, sizeof (struct mphent),
+	  hashheader.nmphslots, houtfile);
+	hashheader.filesize += hashheader.nmphdisps * sizeof (unsigned int)
+	  + hashheader.nmphslots * sizeof (struct mphent);
+	free ((char *) mphdisps);
+	free ((char *) mphtbl);
+	}
+    /* Put out the negative-lookup filter, aligned to a cache line */
+    n = hashheader.filesize % (BLOOMBLOCKWORDS * sizeof (unsigned int));
+    if (n != 0)
+	{
+	n = BLOOMBLOCKWORDS * sizeof (unsigned int) - n;
+	hashheader.filesize += n;
+	while (--n >= 0)
+	    (void) putc ('\0', houtfile);
+	}
+    hashheader.bloomstart = hashheader.filesize;
+    hashheader.nbloomblocks = writebloom (houtfile);
+    hashheader.filesize +=
+      hashheader.nbloomblocks * BLOOMBLOCKWORDS * sizeof (unsigned int);
+    /* The full-form table, near-miss index, and trie need every word */
+    if (fullform  ||  nearmiss  ||  trie)
+	expandall ();
+    /* Put out the full-form table, if wanted */
+    hashheader.fullstart = 0;
+    hashheader.nfullslots = 0;
+    hashheader.nfullhits = 0;
+    if (fullform)
+	{
+	n = hashheader.filesize % sizeof (struct fullform);
+	if (n != 0)
+	    {
+	    n = sizeof (struct fullform) - n;
+	    hashheader.filesize += n;
+	    while (--n >= 0)
+		(void) putc ('\0', houtfile);
+	    }
+	hashheader.fullstart = hashheader.filesize;
+	hashheader.filesize += writefull (houtfile);
+	}
+    /* Put out the near-miss index, if wanted */
+    hashheader.nearstart = 0;
+    hashheader.nnearslots = 0;
+    hashheader.nnearents = 0;
+    if (nearmiss)
+	{
+	n = hashheader.filesize % sizeof (struct nearent);
+	if (n != 0)
+	    {
+	    n = sizeof (struct nearent) - n;
+	    hashheader.filesize += n;
+	    while (--n >= 0)
+		(void) putc ('\0', houtfile);
+	    }
+	hashheader.nearstart = hashheader.filesize;
+	hashheader.filesize += writenear (houtfile);
+	}
+    /* Put out the trie, if wanted */
+    hashheader.triestart = 0;
+    hashheader.ntrienodes = 0;
+    if (trie)
+	{
+	n = hashheader.filesize % sizeof (struct trienode);
+	if (n != 0)
+	    {
+	    n = sizeof (struct trienode) - n;
+	    hashheader.filesize += n;
+	    while (--n >= 0)
+		(void) putc ('\0', houtfile);
+	    }
+	hashheader.triestart = hashheader.filesize;
+	hashheader.filesize += writetrie (houtfile);
+	}
+    if (fullrecs != NULL)
+	free ((char *) fullrecs);
     /* Finish filling in the hash header. */
-    hashheader.stringsize = strptr;
     rewind (houtfile);
     (void) fwrite ((char *) &hashheader, sizeof hashheader, 1, houtfile);
     (void) fclose (houtfile);
     }
 
-static void filltable ()
+/*
+** Build the bucketed index to the hash table and write it to the hash
+** file.  Returns the number of buckets written.
+*/
+static unsigned int writebuckets (houtfile)
+    FILE *		houtfile;	/* File to write the buckets to */
     {
-    struct dent *freepointer, *nextword, *dp;
-    struct dent *hashend;
-    int i;
-    int overflows;
-    
-    hashend = hashtbl + hashsize;
-    for (freepointer = hashtbl;
-      (freepointer->flagfield & USED)  &&  freepointer < hashend;
-      freepointer++)
-	;
-    overflows = 0;
-    for (nextword = hashtbl, i = hashsize; i != 0; nextword++, i--)
+    struct hashbucket *	buckets;	/* Buckets being built */
+    unsigned int	bucketno;	/* Number of current bucket */
+    register struct dent *
+			dp;		/* Entry being indexed */
+    unsigned int	fprint;		/* Fingerprint of entry's word */
+    register unsigned int
+			i;
+    char *		isroot;		/* NZ if entry starts a word */
+    ichar_t *		iword;		/* Entry's word as an ichar_t */
+    unsigned int	nbuckets;	/* Number of buckets needed */
+    unsigned int	nwords;		/* Number of words to index */
+    register int	slot;		/* Slot being tested */
+
+    isroot = findroots (&nwords);
+    /*
+    ** Leave about half the slots empty.  Few buckets then overflow,
+    ** and a search for a word that isn't there (the common case when
+    ** generating suggestions) reaches an empty slot quickly.
+    */
+    nbuckets = nwords * 2 / BUCKETSLOTS + 1;
+    buckets =
+      (struct hashbucket *) calloc (nbuckets, sizeof (struct hashbucket));
+    if (buckets == NULL)
 	{
-	if ((nextword->flagfield & USED) == 0)
-	    continue;
-	if (nextword->next >= hashtbl  &&  nextword->next < hashend)
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    for (i = 0, dp = hashtbl;  i < hashsize;  i++, dp++)
+	{
+	if (!isroot[i])
 	    continue;
-	dp = nextword;
-	while (dp->next)
+	iword = strtosichar (dp->word, 1);
+	fprint = hashfprint (iword);
+	for (bucketno = hash (iword, nbuckets);  ;  )
 	    {
-	    if (freepointer >= hashend)
+	    for (slot = 0;  slot < BUCKETSLOTS;  slot++)
 		{
-		overflows++;
-		dp->next = NULL;
+		if (buckets[bucketno].fprint[slot] == 0)
+		    break;
+		}
+	    if (slot < BUCKETSLOTS)
 		break;
+	    if (++bucketno >= nbuckets)
+		bucketno = 0;
+	    }
+	buckets[bucketno].fprint[slot] = fprint;
+	buckets[bucketno].ent[slot] = i;
+	}
+    (void) fwrite ((char *) buckets, sizeof (struct hashbucket), nbuckets,
+      houtfile);
+    free ((char *) buckets);
+    free (isroot);
+    return nbuckets;
+    }
+
+/*
+** Build a minimal perfect hash of the words in the hash table, using
+** the "hash and displace" method.  Each word's key selects a group; all
+** words in a group are placed by hashing their keys with the group's
+** displacement, which is found by trial so that no two words land in
+** the same slot.  The largest groups are placed first, while the table
+** is still mostly empty.  Returns the number of displacements, which
+** are put in *dispp, or zero if no perfect hash could be found.  The
+** slots (one per word) are put in *tblp.
+*/
+static unsigned int buildmph (dispp, tblp, nslotsp)
+    unsigned int **	dispp;		/* Where to put displacements */
+    struct mphent **	tblp;		/* Where to put slots */
+    unsigned int *	nslotsp;	/* Where to put number of slots */
+    {
+    unsigned int *	check;		/* Check value of each word */
+    unsigned int	disp;		/* Displacement being tried */
+    unsigned int *	disps;		/* Displacement of each group */
+    register struct dent *
+			dp;		/* Entry being hashed */
+    unsigned int *	ent;		/* Entry number of each word */
+    unsigned int	group;		/* Group being placed */
+    unsigned int *	groupstart;	/* First word in each group */
+    unsigned int	groupsize;	/* Number of words in the group */
+    register unsigned int
+			i;
+    char *		isroot;		/* NZ if entry starts a word */
+    register unsigned int
+			j;
+    unsigned int *	key;		/* Key of each word */
+    unsigned int	maxsize;	/* Largest group size */
+    unsigned int	ndisps;		/* Number of groups */
+    unsigned int	nwords;		/* Number of words to hash */
+    unsigned int *	order;		/* Words, grouped */
+    unsigned int *	slot;		/* Slots of words in a group */
+    struct mphent *	tbl;		/* Slots being filled */
+    unsigned int	word;		/* Word being placed */
+
+    isroot = findroots (&nwords);
+    /* An average of four words per group keeps the table small */
+    ndisps = nwords / 4 + 1;
+    key = (unsigned int *) malloc (nwords * sizeof (unsigned int));
+    check = (unsigned int *) malloc (nwords * sizeof (unsigned int));
+    ent = (unsigned int *) malloc (nwords * sizeof (unsigned int));
+    order = (unsigned int *) malloc (nwords * sizeof (unsigned int));
+    groupstart =
+      (unsigned int *) calloc (ndisps + 1, sizeof (unsigned int));
+    disps = (unsigned int *) calloc (ndisps, sizeof (unsigned int));
+    tbl = (struct mphent *) calloc (nwords, sizeof (struct mphent));
+    slot = (unsigned int *) malloc (nwords * sizeof (unsigned int));
+    if (key == NULL  ||  check == NULL  ||  ent == NULL  ||  order == NULL
+      ||  groupstart == NULL  ||  disps == NULL  ||  tbl == NULL
+      ||  slot == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    for (i = 0, j = 0, dp = hashtbl;  i < hashsize;  i++, dp++)
+	{
+	if (!isroot[i])
+	    continue;
+	mphkey (strtosichar (dp->word, 1), &key[j], &check[j]);
+	ent[j] = i;
+	groupstart[check[j] % ndisps + 1]++;
+	j++;
+	}
+    free (isroot);
+    /* Sort the words by group, and find the largest group */
+    for (group = 0, maxsize = 0;  group < ndisps;  group++)
+	{
+	if (groupstart[group + 1] > maxsize)
+	    maxsize = groupstart[group + 1];
+	groupstart[group + 1] += groupstart[group];
+	}
+    for (j = 0;  j < nwords;  j++)
+	order[groupstart[check[j] % ndisps]++] = j;
+    for (group = ndisps;  group > 0;  group--)
+	groupstart[group] = groupstart[group - 1];
+    groupstart[0] = 0;
+    /*
+    ** Place the groups, largest first.  A free slot has an ent of
+    ** zero, so entries are stored offset by one until we're done.
+    */
+    for (groupsize = maxsize;  groupsize > 0;  groupsize--)
+	{
+	for (group = 0;  group < ndisps;  group++)
+	    {
+	    if (groupstart[group + 1] - groupstart[group] != groupsize)
+		continue;
+	    for (disp = 0;  disp < MPHMAXTRIES;  disp++)
+		{
+		for (i = 0;  i < groupsize;  i++)
+		    {
+		    word = order[groupstart[group] + i];
+		    slot[i] = mphslot (key[word], disp, nwords);
+		    if (tbl[slot[i]].ent != 0)
+			break;
+		    for (j = 0;  j < i;  j++)
+			{
+			if (slot[j] == slot[i])
+			    break;
+			}
+		    if (j < i)
+			break;
+		    }
+		if (i >= groupsize)
+		    break;
 		}
-	    else
+	    if (disp >= MPHMAXTRIES)
+		{
+		(void) fprintf (stderr, BHASH_C_NO_MPH);
+		free ((char *) tbl);
+		tbl = NULL;
+		ndisps = 0;
+		goto done;
+		}
+	    disps[group] = disp;
+	    for (i = 0;  i < groupsize;  i++)
+		{
+		word = order[groupstart[group] + i];
+		tbl[slot[i]].ent = ent[word] + 1;
+		tbl[slot[i]].check = check[word];
+		}
+	    }
+	}
+    for (j = 0;  j < nwords;  j++)
+	tbl[j].ent--;
+done:
+    free ((char *) key);
+    free ((char *) check);
+    free ((char *) ent);
+    free ((char *) order);
+    free ((char *) groupstart);
+    free ((char *) slot);
+    if (ndisps == 0)
+	{
+	free ((char *) disps);
+	disps = NULL;
+	}
+    *dispp = disps;
+    *tblp = tbl;
+    *nslotsp = ndisps == 0 ? 0 : nwords;
+    return ndisps;
+    }
+
+/*
+** Build the negative-lookup filter for the words in the hash table and
+** write it to the hash file.  Returns the number of blocks written.
+*/
+static unsigned int writebloom (houtfile)
+    FILE *		houtfile;	/* File to write the filter to */
+    {
+    unsigned int	check;		/* Check value of entry's word */
+    register struct dent *
+			dp;		/* Entry being added */
+    unsigned int *	filter;		/* Filter being built */
+    register unsigned int
+			i;
+    char *		isroot;		/* NZ if entry starts a word */
+    unsigned int	key;		/* Key of entry's word */
+    unsigned int	nblocks;	/* Number of blocks in filter */
+    unsigned int	nwords;		/* Number of words to add */
+
+    isroot = findroots (&nwords);
+    nblocks = nwords * BLOOMBITS / (BLOOMBLOCKWORDS * 32) + 1;
+    filter = (unsigned int *)
+      calloc (nblocks * BLOOMBLOCKWORDS, sizeof (unsigned int));
+    if (filter == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    for (i = 0, dp = hashtbl;  i < hashsize;  i++, dp++)
+	{
+	if (!isroot[i])
+	    continue;
+	mphkey (strtosichar (dp->word, 1), &key, &check);
+	bloomadd (filter, nblocks, key, check);
+	}
+    (void) fwrite ((char *) filter, BLOOMBLOCKWORDS * sizeof (unsigned int),
+      nblocks, houtfile);
+    free ((char *) filter);
+    free (isroot);
+    return nblocks;
+    }
+
+/*
+** Expand every root with each of its affixes, and with each
+** combination of a suffix and a prefix that allows cross products,
+** exactly as chk_aff would strip them off again.  The derivations are
+** left in fullrecs.
+*/
+static void expandall ()
+    {
+    register unsigned int
+			i;
+    char *		isroot;		/* NZ if entry starts a word */
+    unsigned int	nwords;		/* Number of roots */
+
+    isroot = findroots (&nwords);
+    for (i = 0;  i < hashsize;  i++)
+	{
+	if (isroot[i])
+	    expandroot (i);
+	}
+    free (isroot);
+    }
+
+/*
+** Build the full-form table (see ispell.h) from the derivations found
+** by expandall, and write it to the hash file.  The derivations are
+** sorted to bring those of each word together, in the order that
+** chk_aff finds them.  Fills in the counts in the hash header, and
+** returns the number of bytes written.
+*/
+static unsigned int writefull (houtfile)
+    FILE *		houtfile;	/* File to write the table to */
+    {
+    unsigned int	fprint;		/* Fingerprint of word */
+    struct fullhit *	hitlist;	/* Hits being built */
+    register unsigned int
+			i;
+    ichar_t *		iword;		/* Word as an ichar_t */
+    register unsigned int
+			j;
+    unsigned int	nforms;		/* Number of distinct words */
+    unsigned int	nslots;		/* Number of slots in table */
+    unsigned int	slot;		/* Slot being tried */
+    struct fullform *	slots;		/* Slots being filled */
+    unsigned int	strptr;		/* Offset of next word's string */
+
+    qsort ((char *) fullrecs, (unsigned) nfullrecs, sizeof (struct fullrec),
+      (int (*) P ((const void *, const void *))) fullcmp);
+    for (i = 0, nforms = 0;  i < nfullrecs;  i++)
+	{
+	if (i == 0
+	  ||  strcmp ((char *) fullrecs[i].word,
+	    (char *) fullrecs[i - 1].word) != 0)
+	    nforms++;
+	}
+    /* Leave half the slots empty, so that misses are found quickly */
+    nslots = nforms * 2 + 1;
+    slots = (struct fullform *) malloc (nslots * sizeof (struct fullform));
+    hitlist = (struct fullhit *)
+      malloc ((nfullrecs + 1) * sizeof (struct fullhit));
+    if (slots == NULL  ||  hitlist == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    for (slot = 0;  slot < nslots;  slot++)
+	slots[slot].word = NOWORD;
+    strptr = 0;
+    for (i = 0;  i < nfullrecs;  i = j)
+	{
+	iword = strtosichar (fullrecs[i].word, 1);
+	fprint = hashfprint (iword);
+	for (slot = hash (iword, nslots);
+	  slots[slot].word != NOWORD;
+	  slot = (slot + 1) % nslots)
+	    ;
+	slots[slot].word = strptr;
+	slots[slot].firsthit = i;
+	slots[slot].fprint = fprint;
+	strptr += strlen ((char *) fullrecs[i].word) + 1;
+	for (j = i;
+	  j < nfullrecs
+	    &&  strcmp ((char *) fullrecs[j].word,
+	      (char *) fullrecs[i].word) == 0;
+	  j++)
+	    {
+	    hitlist[j].ent = fullrecs[j].ent;
+	    hitlist[j].prefix = fullrecs[j].prefix;
+	    hitlist[j].suffix = fullrecs[j].suffix;
+	    }
+	slots[slot].nhits = j - i;
+	}
+    (void) fwrite ((char *) slots, sizeof (struct fullform), nslots,
+      houtfile);
+    (void) fwrite ((char *) hitlist, sizeof (struct fullhit), nfullrecs,
+      houtfile);
+    for (i = 0;  i < nfullrecs;  i++)
+	{
+	if (i == 0
+	  ||  strcmp ((char *) fullrecs[i].word,
+	    (char *) fullrecs[i - 1].word) != 0)
+	    (void) fwrite ((char *) fullrecs[i].word,
+	      strlen ((char *) fullrecs[i].word) + 1, 1, houtfile);
+	}
+    free ((char *) slots);
+    free ((char *) hitlist);
+    hashheader.nfullslots = nslots;
+    hashheader.nfullhits = nfullrecs;
+    return nslots * sizeof (struct fullform)
+      + nfullrecs * sizeof (struct fullhit) + strptr;
+    }
+
+/*
+** Record every word that can be derived from one root.  The affixes
+** that can be applied are those that chk_aff would accept when
+** checking the result:  not compound-only, with a matching strip
+** string and conditions, and (for cross products) both allowing it,
+** with the prefix's conditions applied to the suffixed word.
+*/
+static void expandroot (ent)
+    unsigned int	ent;		/* Index of root in hashtbl */
+    {
+    register struct flagent *
+			flent;		/* Prefix being applied */
+    register unsigned int
+			i;
+    register unsigned int
+			j;
+    MASKTYPE *		mask;		/* Root's affix flags */
+    int			rootlen;	/* Length of root */
+    ichar_t		root[INPUTWORDLEN + 4 * MAXAFFIXLEN + 4];
+    register struct flagent *
+			sflent;		/* Suffix being applied */
+    ichar_t		sword[sizeof root]; /* Root with suffix */
+    ichar_t		word[sizeof root]; /* Root with prefix */
+
+    mask = hashtbl[ent].mask;
+    if (strtoichar (root, hashtbl[ent].word, sizeof root, 1))
+	return;
+    rootlen = icharlen (root);
+    for (i = 0, flent = pflaglist;  i < numpflags;  i++, flent++)
+	{
+	if (TSTMASKBIT (mask, flent->flagbit)
+	  &&  pfxapplies (flent, root, rootlen, word))
+	    addfullform (word, ent, i, NOAFFIX);
+	}
+    for (j = 0, sflent = sflaglist;  j < numsflags;  j++, sflent++)
+	{
+	if (!TSTMASKBIT (mask, sflent->flagbit)
+	  ||  !sfxapplies (sflent, root, rootlen, sword))
+	    continue;
+	addfullform (sword, ent, NOAFFIX, j);
+	if ((sflent->flagflags & FF_CROSSPRODUCT) == 0)
+	    continue;
+	for (i = 0, flent = pflaglist;  i < numpflags;  i++, flent++)
+	    {
+	    if ((flent->flagflags & FF_CROSSPRODUCT) != 0
+	      &&  TSTMASKBIT (mask, flent->flagbit)
+	      &&  pfxapplies (flent, sword, icharlen (sword), word))
+		addfullform (word, ent, i, j);
+	    }
+	}
+    }
+
+/*
+** See if a prefix can be applied to a word, and if so put the result
+** in "word".  Returns NZ if it can.
+*/
+static int pfxapplies (flent, root, len, word)
+    register struct flagent *
+			flent;		/* Prefix to apply */
+    ichar_t *		root;		/* Word to apply it to */
+    int			len;		/* Length of root */
+    ichar_t *		word;		/* Where to put the result */
+    {
+    register int	cond;		/* Condition number */
+
+    if ((flent->flagflags & FF_COMPOUNDONLY) != 0
+      ||  len <= flent->stripl
+      ||  len < flent->numconds
+      ||  icharncmp (root, flent->strip, flent->stripl) != 0)
+	return 0;
+    for (cond = 0;  cond < flent->numconds;  cond++)
+	{
+	if ((flent->conds[condclassof (root[cond])] & (1 << cond)) == 0)
+	    return 0;
+	}
+    (void) icharcpy (word, flent->affix);
+    (void) icharcpy (word + flent->affl, root + flent->stripl);
+    return 1;
+    }
+
+/*
+** See if a suffix can be applied to a word, and if so put the result
+** in "word".  Returns NZ if it can.
+*/
+static int sfxapplies (flent, root, len, word)
+    register struct flagent *
+			flent;		/* Suffix to apply */
+    ichar_t *		root;		/* Word to apply it to */
+    int			len;		/* Length of root */
+    ichar_t *		word;		/* Where to put the result */
+    {
+    register int	cond;		/* Condition number */
+    ichar_t *		cp;		/* First char tested by conds */
+
+    if ((flent->flagflags & FF_COMPOUNDONLY) != 0
+      ||  len <= flent->stripl
+      ||  len < flent->numconds
+      ||  icharcmp (root + len - flent->stripl, flent->strip) != 0)
+	return 0;
+    cp = root + len - flent->numconds;
+    for (cond = 0;  cond < flent->numconds;  cond++)
+	{
+	if ((flent->conds[condclassof (cp[cond])] & (1 << cond)) == 0)
+	    return 0;
+	}
+    (void) icharcpy (word, root);
+    (void) icharcpy (word + len - flent->stripl, flent->affix);
+    return 1;
+    }
+
+/*
+** Add a derivation to the list for the full-form table.
+*/
+static void addfullform (word, ent, prefix, suffix)
+    ichar_t *		word;		/* Derived word */
+    unsigned int	ent;		/* Index of root in hashtbl */
+    unsigned int	prefix;		/* Index in pflaglist, or NOAFFIX */
+    unsigned int	suffix;		/* Index in sflaglist, or NOAFFIX */
+    {
+    unsigned char	sword[INPUTWORDLEN + 4 * MAXAFFIXLEN + 4];
+    register struct fullrec *
+			rp;
+
+    if (ichartostr (sword, word, sizeof sword, 1))
+	return;
+    if (nfullrecs >= fullrecsize)
+	{
+	fullrecsize = fullrecsize == 0 ? 1024 : fullrecsize * 2;
+	fullrecs = (struct fullrec *)
+	  realloc ((char *) fullrecs, fullrecsize * sizeof (struct fullrec));
+	if (fullrecs == NULL)
+	    {
+	    (void) fprintf (stderr, BHASH_C_NO_SPACE);
+	    exit (1);
+	    }
+	}
+    rp = &fullrecs[nfullrecs++];
+    rp->word = (unsigned char *) mymalloc (strlen ((char *) sword) + 1);
+    if (rp->word == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    (void) strcpy ((char *) rp->word, (char *) sword);
+    rp->ent = ent;
+    rp->prefix = prefix;
+    rp->suffix = suffix;
+    }
+
+/*
+** Compare two derivations for sorting the full-form table:  by word,
+** and then in the order chk_aff tries them.  That is all of those
+** involving a prefix, in the order of the prefix list, each prefix
+** alone before its cross products, and then those with only a
+** suffix.  Because the affix lists are sorted, list order puts the
+** affixes that match any one word shortest first, as the trie walks do.
+*/
+static int fullcmp (a, b)
+    struct fullrec *	a;		/* First derivation */
+    struct fullrec *	b;		/* Second derivation */
+    {
+    int			result;
+
+    result = strcmp ((char *) a->word, (char *) b->word);
+    if (result != 0)
+	return result;
+    if ((a->prefix == NOAFFIX) != (b->prefix == NOAFFIX))
+	return a->prefix == NOAFFIX ? 1 : -1;
+    if (a->prefix != b->prefix)
+	return (int) a->prefix - (int) b->prefix;
+    if ((a->suffix == NOAFFIX) != (b->suffix == NOAFFIX))
+	return a->suffix == NOAFFIX ? -1 : 1;
+    return (int) a->suffix - (int) b->suffix;
+    }
+
+/*
+** Build the near-miss index (see ispell.h) and write it to the hash
+** file.  The words indexed are those found by findforms; words too long
+** to be a near miss of any word ispell checks are left out.  Fills in the counts in the hash header, and
+** returns the number of bytes written.
+*/
+static unsigned int writenear (houtfile)
+    FILE *		houtfile;	/* File to write the index to */
+    {
+    unsigned int *	fill;		/* Next entry to fill in each slot */
+    unsigned char **	forms;		/* Words to index */
+    register unsigned int
+			i;
+    ichar_t		iword[INPUTWORDLEN + 4 * MAXAFFIXLEN + 4];
+					/* Word as an ichar_t */
+    register int	j;
+    ichar_t		key[sizeof iword / sizeof (ichar_t)];
+					/* Key being filed */
+    int			len;		/* Length of iword */
+    struct nearent *	ents;		/* Entries being built */
+    unsigned int	nents;		/* Number of entries */
+    unsigned int	nforms;		/* Number of distinct words */
+    unsigned int	nslots;		/* Number of slots */
+    int			pass;		/* 0 to count, 1 to fill in */
+    unsigned int	slot;		/* Slot of current key */
+    unsigned int *	slots;		/* First entry in each slot */
+    unsigned int	strptr;		/* Offset of current word */
+
+    forms = findforms (&nforms);
+    /*
+    ** Each word has about as many keys as characters.  Allow one slot
+    ** per character, so slots rarely hold more than one or two keys.
+    */
+    for (i = 0, nslots = 1;  i < nforms;  i++)
+	nslots += strlen ((char *) forms[i]) + 1;
+    slots = (unsigned int *) calloc (nslots + 1, sizeof (unsigned int));
+    fill = (unsigned int *) malloc (nslots * sizeof (unsigned int));
+    if (slots == NULL  ||  fill == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    /*
+    ** Make two passes over the keys:  the first counts the entries in
+    ** each slot, and the second files them.  A deletion that gives the
+    ** same key as the one before it (as deleting either L of "ALL"
+    ** does) is skipped.
+    */
+    ents = NULL;
+    nents = 0;
+    for (pass = 0;  pass < 2;  pass++)
+	{
+	for (i = 0, strptr = 0;
+	  i < nforms;
+	  strptr += strlen ((char *) forms[i]) + 1, i++)
+	    {
+	    if (strtoichar (iword, forms[i], sizeof iword, 1))
+		continue;
+	    upcase (iword);
+	    len = icharlen (iword);
+	    if (len > INPUTWORDLEN)
+		continue;
+	    for (j = -1;  j < len;  j++)
 		{
-		*freepointer = *(dp->next);
-		dp->next = freepointer;
-		dp = freepointer;
+		if (j > 0  &&  iword[j] == iword[j - 1])
+		    continue;
+		(void) icharcpy (key, iword);
+		if (j >= 0)
+		    (void) icharcpy (key + j, iword + j + 1);
+		slot = hash (key, nslots);
+		if (pass == 0)
+		    {
+		    slots[slot + 1]++;
+		    nents++;
+		    }
+		else
+		    {
+		    ents[fill[slot]].word = strptr;
+		    ents[fill[slot]++].fprint = hashfprint (key);
+		    }
+		}
+	    }
+	if (pass == 0)
+	    {
+	    for (slot = 0;  slot < nslots;  slot++)
+		{
+		slots[slot + 1] += slots[slot];
+		fill[slot] = slots[slot];
+		}
+	    ents = (struct nearent *)
+	      malloc ((nents + 1) * sizeof (struct nearent));
+	    if (ents == NULL)
+		{
+		(void) fprintf (stderr, BHASH_C_NO_SPACE);
+		exit (1);
+		}
+	    }
+	}
+    (void) fwrite ((char *) slots, sizeof (unsigned int), nslots + 1,
+      houtfile);
+    (void) fwrite ((char *) ents, sizeof (struct nearent), nents, houtfile);
+    for (i = 0;  i < nforms;  i++)
+	(void) fwrite ((char *) forms[i], strlen ((char *) forms[i]) + 1, 1,
+	  houtfile);
+    free ((char *) slots);
+    free ((char *) fill);
+    free ((char *) ents);
+    free ((char *) forms);
+    hashheader.nnearslots = nslots;
+    hashheader.nnearents = nents;
+    return (nslots + 1) * sizeof (unsigned int)
+      + nents * sizeof (struct nearent) + strptr;
+    }
+
+/*
+** Build the trie (see ispell.h) of the words found by findforms, and
+** write it to the hash file.  Because the words are sorted, those
+** below any node are together in the list, and each child of the node
+** covers a run of them.  The nodes are made in breadth-first order, so
+** that the children of each node are made, and kept, together.  Fills
+** in the count in the hash header, and returns the number of bytes
+** written.
+*/
+static unsigned int writetrie (houtfile)
+    FILE *		houtfile;	/* File to write the trie to */
+    {
+    ichar_t		ch;		/* Character leading to a child */
+    unsigned int *	depth;		/* Depth of each node */
+    unsigned char **	forms;		/* Words to put in the trie */
+    unsigned int *	hi;		/* End of each node's words */
+    register unsigned int
+			i;
+    ichar_t **		iwords;		/* Words as ichar_t's */
+    register unsigned int
+			j;
+    register unsigned int
+			k;
+    int			len;		/* Length of a word */
+    unsigned int *	lo;		/* First of each node's words */
+    unsigned int	nforms;		/* Number of distinct words */
+    unsigned int	nnodes;		/* Number of nodes */
+    unsigned int	nextnode;	/* Next node to make */
+    struct trienode *	nodes;		/* Nodes being built */
+
+    forms = findforms (&nforms);
+    iwords = (ichar_t **) malloc ((nforms + 1) * sizeof (ichar_t *));
+    if (iwords == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    /*
+    ** Count the nodes:  the root, one for each distinct prefix, and
+    ** one to mark the end of each word.
+    */
+    for (i = 0, nnodes = 1;  i < nforms;  i++)
+	{
+	len = strlen ((char *) forms[i]) + 1;
+	iwords[i] = (ichar_t *) malloc (len * sizeof (ichar_t));
+	if (iwords[i] == NULL)
+	    {
+	    (void) fprintf (stderr, BHASH_C_NO_SPACE);
+	    exit (1);
+	    }
+	(void) strtoichar (iwords[i], forms[i], len * sizeof (ichar_t), 1);
+	upcase (iwords[i]);
+	for (j = 0;
+	  i > 0  &&  iwords[i][j] != 0  &&  iwords[i][j] == iwords[i - 1][j];
+	  j++)
+	    ;
+	nnodes += icharlen (iwords[i]) - j + 1;
+	}
+    nodes = (struct trienode *) calloc (nnodes, sizeof (struct trienode));
+    lo = (unsigned int *) malloc (nnodes * sizeof (unsigned int));
+    hi = (unsigned int *) malloc (nnodes * sizeof (unsigned int));
+    depth = (unsigned int *) malloc (nnodes * sizeof (unsigned int));
+    if (nodes == NULL  ||  lo == NULL  ||  hi == NULL  ||  depth == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    lo[0] = 0;
+    hi[0] = nforms;
+    depth[0] = 0;
+    for (i = 0, nextnode = 1;  i < nextnode;  i++)
+	{
+	if (i != 0  &&  nodes[i].ch == 0)
+	    continue;			/* End of a word, a leaf */
+	nodes[i].kids = nextnode;
+	for (j = lo[i];  j < hi[i];  j = k)
+	    {
+	    ch = iwords[j][depth[i]];
+	    for (k = j + 1;  k < hi[i]  &&  iwords[k][depth[i]] == ch;  k++)
+		;
+	    nodes[nextnode].ch = ch;
+	    lo[nextnode] = j;
+	    hi[nextnode] = k;
+	    depth[nextnode++] = depth[i] + 1;
+	    }
+	nodes[i].nkids = nextnode - nodes[i].kids;
+	}
+    nnodes = nextnode;
+    (void) fwrite ((char *) nodes, sizeof (struct trienode), nnodes,
+      houtfile);
+    for (i = 0;  i < nforms;  i++)
+	free ((char *) iwords[i]);
+    free ((char *) iwords);
+    free ((char *) forms);
+    free ((char *) nodes);
+    free ((char *) lo);
+    free ((char *) hi);
+    free ((char *) depth);
+    hashheader.ntrienodes = nnodes;
+    return nnodes * sizeof (struct trienode);
+    }
+
+/*
+** Make a sorted list of the distinct words the dictionary accepts:  the
+** roots and the derivations found by expandall, all as canonical
+** strings.  Returns the list, which the caller must free, and puts the
+** number of words in *nforms.
+*/
+static unsigned char ** findforms (nforms)
+    unsigned int *	nforms;		/* Where to put number of words */
+    {
+    unsigned char **	forms;		/* Words found */
+    register unsigned int
+			i;
+    char *		isroot;		/* NZ if entry starts a word */
+    register unsigned int
+			j;
+    unsigned int	nwords;		/* Number of roots */
+
+    isroot = findroots (&nwords);
+    forms = (unsigned char **)
+      malloc ((nwords + nfullrecs + 1) * sizeof (unsigned char *));
+    if (forms == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    for (i = 0, j = 0;  i < hashsize;  i++)
+	{
+	if (isroot[i])
+	    forms[j++] = hashtbl[i].word;
+	}
+    free (isroot);
+    for (i = 0;  i < nfullrecs;  i++)
+	forms[j++] = fullrecs[i].word;
+    qsort ((char *) forms, (unsigned) j, sizeof (unsigned char *),
+      (int (*) P ((const void *, const void *))) formcmp);
+    for (i = 0, *nforms = 0;  i < j;  i++)
+	{
+	if (*nforms == 0
+	  ||  strcmp ((char *) forms[i], (char *) forms[*nforms - 1]) != 0)
+	    forms[(*nforms)++] = forms[i];
+	}
+    return forms;
+    }
+
+/*
+** Compare two words for sorting them in findforms.
+*/
+static int formcmp (a, b)
+    unsigned char **	a;		/* First word */
+    unsigned char **	b;		/* Second word */
+    {
+
+    return strcmp ((char *) *a, (char *) *b);
+    }
+
+/*
+** Find the hash-table entries that start a word:  those that are in
+** use.  Capitalization variants are kept after the table, where they
+** are reached by way of their headers, so only these need to be found
+** by the indexes.  Returns a malloc'ed array of hashsize flags, and the
+** number of words in *nwordsp.
+*/
+static char * findroots (nwordsp)
+    unsigned int *	nwordsp;	/* Where to put number of words */
+    {
+    register struct dent *
+			dp;		/* Entry being checked */
+    register unsigned int
+			i;
+    char *		isroot;		/* NZ if entry starts a word */
+
+    isroot = (char *) malloc ((unsigned) hashsize);
+    if (isroot == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    for (i = 0, *nwordsp = 0, dp = hashtbl;  i < hashsize;  i++, dp++)
+	{
+	isroot[i] = dp->word != NULL;
+	if (isroot[i])
+	    (*nwordsp)++;
+	}
+    return isroot;
+    }
+
+/*
+** Find the number of an entry's mask in hashmasks, adding the mask to
+** the table if it isn't there yet.  Masks are found by way of maskhash,
+** which holds mask numbers plus one, so that zero marks an empty slot.
+*/
+static unsigned int findmask (dp)
+    register struct dent *
+			dp;		/* Entry whose mask is wanted */
+    {
+    register unsigned long
+			h;		/* Hash of the mask */
+    register int	i;
+    register struct hashmask *
+			mp;		/* Mask being compared */
+    register unsigned int
+			slot;		/* Slot in maskhash */
+
+    for (i = 0, h = 0;  i < MASKSIZE;  i++)
+	h = (h ^ (unsigned long) dp->mask[i]) * 1000003;
+#ifdef FULLMASKSET
+    h = (h ^ (unsigned long) dp->flags) * 1000003;
+#endif
+    h ^= h >> 16;
+    for (slot = h % MASKHASHSIZE;  maskhash[slot] != 0;  )
+	{
+	mp = &hashmasks[maskhash[slot] - 1];
+	for (i = 0;  i < MASKSIZE;  i++)
+	    {
+	    if (mp->mask[i] != dp->mask[i])
+		break;
+	    }
+#ifdef FULLMASKSET
+	if (i >= MASKSIZE  &&  mp->flags == dp->flags)
+#else
+	if (i >= MASKSIZE)
+#endif
+	    return maskhash[slot] - 1;
+	if (++slot >= MASKHASHSIZE)
+	    slot = 0;
+	}
+    if (nmasks >= MAXHASHMASKS)
+	{
+	(void) fprintf (stderr, BHASH_C_MANY_MASKS, MAXHASHMASKS);
+	exit (1);
+	}
+    mp = &hashmasks[nmasks];
+    (void) BCOPY ((char *) dp->mask, (char *) mp->mask, sizeof mp->mask);
+#ifdef FULLMASKSET
+    mp->flags = dp->flags;
+#endif
+    maskhash[slot] = ++nmasks;
+    return nmasks - 1;
+    }
+
+/*
+** Write the words to the hash file in packed form (buildhash -z),
+** filling in the word offsets of the hash-file entries.  The commonest
+** digrams in the words are given the byte codes that no word uses, and
+** the packed words are then merged by their tails:  a word that ends
+** another (as "AND" ends "BLAND") isn't stored, but points into the
+** longer word.  Sorting the words by their reversed spelling brings
+** each word next to the words it ends.  Returns the new size of the
+** string table.
+*/
+static unsigned long writepacked (houtfile, hents, strptr)
+    FILE *		houtfile;	/* File to write the words to */
+    struct hashdent *	hents;		/* Entries to fill in */
+    unsigned long	strptr;		/* Size of strings so far */
+    {
+    unsigned int	best;		/* Commonest digram left */
+    register unsigned char *
+			cp;		/* Character being counted */
+    int			code;		/* Code being assigned */
+    unsigned long *	counts;		/* Number of uses of each digram */
+    register struct dent *
+			dp;		/* Entry being packed */
+    register unsigned int
+			i;
+    register unsigned int
+			j;
+    unsigned int	m;		/* Length of word ended by this one */
+    unsigned int	n;		/* Length of this word */
+    unsigned int	nwords;		/* No. of words to write */
+    unsigned int *	order;		/* Entries in reversed-word order */
+    char		used[SET_SIZE];	/* NZ if a word uses the char */
 
-		while ((freepointer->flagfield & USED)
-		  &&  freepointer < hashend)
-		    freepointer++;
+    counts = (unsigned long *)
+      calloc ((unsigned) (SET_SIZE * SET_SIZE), sizeof (unsigned long));
+    order = (unsigned int *)
+      malloc ((unsigned) (hashsize + nvariants) * sizeof (unsigned int));
+    packedents = (unsigned char **)
+      calloc ((unsigned) (hashsize + nvariants), sizeof (unsigned char *));
+    if (counts == NULL  ||  order == NULL  ||  packedents == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    for (code = 0;  code < SET_SIZE;  code++)
+	used[code] = 0;
+    for (i = 0, dp = hashtbl;  i < hashsize + nvariants;  i++, dp++)
+	{
+	if (dp->word == NULL)
+	    continue;
+	for (cp = dp->word;  *cp != '\0';  cp++)
+	    {
+	    used[*cp] = 1;
+	    if (cp[1] != '\0')
+		counts[*cp * SET_SIZE + cp[1]]++;
+	    }
+	}
+    /*
+    ** Give each unused code to the commonest digram not yet coded.
+    ** No digram starts with a null, so counts[0] is always zero.
+    */
+    for (code = 1;  code < SET_SIZE;  code++)
+	{
+	if (used[code])
+	    continue;
+	for (best = 0, j = 1;  j < SET_SIZE * SET_SIZE;  j++)
+	    {
+	    if (counts[j] > counts[best])
+		best = j;
+	    }
+	if (counts[best] < 2)
+	    break;
+	hashheader.digrams[code][0] = best / SET_SIZE;
+	hashheader.digrams[code][1] = best % SET_SIZE;
+	counts[best] = 0;
+	}
+    free ((char *) counts);
+    packinit ();
+    for (i = 0, nwords = 0, dp = hashtbl;
+      i < hashsize + nvariants;
+      i++, dp++)
+	{
+	if (dp->word == NULL)
+	    continue;
+	packedents[i] = (unsigned char *)
+	  malloc ((unsigned) strlen ((char *) dp->word) + 1);
+	if (packedents[i] == NULL)
+	    {
+	    (void) fprintf (stderr, BHASH_C_NO_SPACE);
+	    exit (1);
+	    }
+	packword (packedents[i], dp->word);
+	order[nwords++] = i;
+	}
+    qsort ((char *) order, (unsigned) nwords, sizeof (order[0]),
+      (int (*) P ((const void *, const void *))) revcmp);
+    /*
+    ** Go from the end, so that a word's storage is known before we
+    ** reach the word just before it, which may end it.
+    */
+    for (j = nwords, m = 0;  j-- > 0;  m = n)
+	{
+	i = order[j];
+	n = strlen ((char *) packedents[i]);
+	if (j + 1 < nwords  &&  m >= n
+	  &&  strcmp ((char *) packedents[order[j + 1]] + m - n,
+	    (char *) packedents[i]) == 0)
+	    hents[i].word = hents[order[j + 1]].word + m - n;
+	else
+	    {
+	    (void) fwrite (packedents[i], n + 1, 1, houtfile);
+	    hents[i].word = strptr;
+	    strptr += n + 1;
+	    }
+	}
+    for (j = 0;  j < nwords;  j++)
+	free ((char *) packedents[order[j]]);
+    free ((char *) packedents);
+    free ((char *) order);
+    return strptr;
+    }
+
+/*
+** Compare two entries' packed words from the end, for sorting by
+** reversed spelling.  A word sorts just before any word it ends.
+*/
+static int revcmp (enta, entb)
+    unsigned int *	enta;		/* Index of first entry */
+    unsigned int *	entb;		/* Index of second entry */
+    {
+    register unsigned char *
+			a;		/* Next char of first word */
+    register unsigned char *
+			b;		/* Next char of second word */
+    unsigned char *	starta;		/* Start of first word */
+    unsigned char *	startb;		/* Start of second word */
+
+    starta = packedents[*enta];
+    startb = packedents[*entb];
+    a = starta + strlen ((char *) starta);
+    b = startb + strlen ((char *) startb);
+    while (a > starta  &&  b > startb)
+	{
+	if (*--a != *--b)
+	    return (int) *a - (int) *b;
+	}
+    return (a > starta) - (b > startb);
+    }
+
+/*
+** Build the index to a sorted list of suffix or prefix flags and
+** write it to the hash file.  Returns the number of bytes written.
+*/
+static unsigned int writeindex (houtfile, list, nflags, suffix)
+    FILE *		houtfile;	/* File to write the index to */
+    struct flagent *	list;		/* Sorted list of flags to index */
+    unsigned int	nflags;		/* Number of entries in list */
+    int			suffix;		/* NZ if list is the suffix flags */
+    {
+    unsigned int	size;		/* Size of index in bytes */
+
+    flagindex = (struct affixnode *) calloc (1, sizeof (struct affixnode));
+    if (flagindex == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    indexsize = 1;
+    buildindex (list, 0, nflags, 0, suffix, 0);
+    (void) fwrite ((char *) flagindex, sizeof (struct affixnode), indexsize,
+      houtfile);
+    size = indexsize * sizeof (struct affixnode);
+    free ((char *) flagindex);
+    flagindex = NULL;
+    return size;
+    }
+
+/*
+** Fill in a node of the affix trie (see ispell.h) from the entries of
+** a sorted flag list whose affixes share their first (or, for
+** suffixes, last) "depth" characters, and build its subtrees.  The
+** list is sorted on those same characters, so the entries whose affix
+** is exactly that long come first, and the rest are grouped by their
+** next character in increasing order.  The children of a node are
+** allocated together before any of them is filled in, so that they are
+** consecutive; the array is grown as that is done, so nodes are always
+** referred to by position.
+*/
+static void buildindex (list, lo, hi, depth, suffix, node)
+    struct flagent *	list;		/* Sorted list of flags to index */
+    unsigned int	lo;		/* First entry under this node */
+    unsigned int	hi;		/* Last entry under it, plus one */
+    int			depth;		/* Length of the node's path */
+    int			suffix;		/* NZ if list is the suffix flags */
+    unsigned int	node;		/* Index of the node to fill in */
+    {
+    unsigned int	child;		/* Index of child being built */
+    unsigned int	i;
+    unsigned int	nchildren;	/* Number of children of node */
+    unsigned int	start;		/* First entry for current child */
+
+    for (i = lo;  i < hi  &&  list[i].affl == depth;  i++)
+	;
+    flagindex[node].firstent = lo;
+    flagindex[node].numents = i - lo;
+    lo = i;
+    nchildren = 0;
+    for (i = lo;  i < hi;  i++)
+	{
+	if (i == lo
+	  ||  affixchar (&list[i], depth, suffix)
+	    != affixchar (&list[i - 1], depth, suffix))
+	    nchildren++;
+	}
+    flagindex[node].firstchild = indexsize;
+    flagindex[node].nchildren = nchildren;
+    if (nchildren == 0)
+	return;
+    flagindex = (struct affixnode *) realloc ((char *) flagindex,
+      (indexsize + nchildren) * sizeof (struct affixnode));
+    if (flagindex == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    (void) BZERO ((char *) &flagindex[indexsize],
+      nchildren * sizeof (struct affixnode));
+    child = indexsize;
+    indexsize += nchildren;
+    for (start = lo;  start < hi;  child++, start = i)
+	{
+	flagindex[child].ch = affixchar (&list[start], depth, suffix);
+	for (i = start + 1;
+	  i < hi  &&  affixchar (&list[i], depth, suffix) == flagindex[child].ch;
+	  i++)
+	    ;
+	buildindex (list, start, i, depth + 1, suffix, child);
+	}
+    }
+
+/*
+** Return the character of an affix that is indexed at a given depth
+** of the trie.
+*/
+static ichar_t affixchar (entry, depth, suffix)
+    struct flagent *	entry;		/* Entry holding the affix */
+    int			depth;		/* Depth in trie */
+    int			suffix;		/* NZ if entry is a suffix */
+    {
+
+    if (suffix)
+	return entry->affix[entry->affl - 1 - depth];
+    else
+	return entry->affix[depth];
+    }
+
+/*
+** Lay the entries out as they will appear in the hash file.  The table
+** proper is resized to hold one entry per word (a standalone entry or a
+** variant header), each in the slot chosen by hash() if that is free
+** and otherwise in a free slot linked onto the end of that slot's
+** chain.  The capitalization variants follow the table, those of each
+** word together, so the chains hold nothing a lookup has to skip.
+*/
+static void filltable ()
+    {
+    struct dent *	dp;		/* Last entry of word */
+    struct dent *	freepointer;	/* Next possibly free word slot */
+    unsigned int	i;
+    struct dent **	later;		/* Words not in home slots */
+    struct dent *	lastdp;		/* End of home slot's chain */
+    unsigned int	nlater;		/* No. of words in later */
+    unsigned int	nwords;		/* No. of words in the table */
+    struct dent *	newtbl;		/* Table being laid out */
+    struct dent *	nextvar;	/* Next free variant slot */
+    struct dent *	wp;		/* Word being placed */
+
+    nwords = 0;
+    nvariants = 0;
+    for (i = 0;  i < hashsize;  i++)
+	{
+	if ((hashtbl[i].flagfield & USED) == 0)
+	    continue;
+	for (dp = &hashtbl[i];  dp != NULL;  dp = dp->next)
+	    {
+	    nwords++;
+	    while (dp->flagfield & MOREVARIANTS)
+		{
+		dp = dp->next;
+		nvariants++;
 		}
 	    }
 	}
-    if (overflows)
-	(void) fprintf (stderr, BHASH_C_OVERFLOW, overflows);
+    newtbl = (struct dent *)
+      calloc ((unsigned) (nwords + nvariants), sizeof (struct dent));
+    later = (struct dent **) malloc (nwords * sizeof (struct dent *));
+    if (newtbl == NULL  ||  later == NULL)
+	{
+	(void) fprintf (stderr, BHASH_C_NO_SPACE);
+	exit (1);
+	}
+    /* First put every word that can go there in its home slot */
+    nextvar = newtbl + nwords;
+    nlater = 0;
+    for (i = 0;  i < hashsize;  i++)
+	{
+	if ((hashtbl[i].flagfield & USED) == 0)
+	    continue;
+	for (wp = &hashtbl[i];  wp != NULL;  wp = dp->next)
+	    {
+	    lastdp = &newtbl[hash (strtosichar (wp->word, 1), nwords)];
+	    if (lastdp->flagfield & USED)
+		later[nlater++] = wp;
+	    else
+		placeword (wp, lastdp, &nextvar);
+	    for (dp = wp;  dp->flagfield & MOREVARIANTS;  dp = dp->next)
+		;
+	    }
+	}
+    /* Then chain the rest into the slots left over */
+    freepointer = newtbl;
+    for (i = 0;  i < nlater;  i++)
+	{
+	wp = later[i];
+	while (freepointer->flagfield & USED)
+	    freepointer++;
+	for (lastdp = &newtbl[hash (strtosichar (wp->word, 1), nwords)];
+	  ;
+	  lastdp = lastdp->next)
+	    {
+	    while (lastdp->flagfield & MOREVARIANTS)
+		lastdp = lastdp->next;
+	    if (lastdp->next == NULL)
+		break;
+	    }
+	lastdp->next = freepointer;
+	placeword (wp, freepointer, &nextvar);
+	}
+    free ((char *) later);
+    free ((char *) hashtbl);
+    hashtbl = newtbl;
+    hashsize = nwords;
+    }
+
+/*
+** Copy a word's entry to its slot in the table being laid out by
+** filltable, and its variants (if any) to the next free places after
+** the table.  The copy ends its chain;  filltable links on any word
+** that follows.
+*/
+static void placeword (wp, ndp, nextvarp)
+    register struct dent *
+			wp;		/* Word to place */
+    register struct dent *
+			ndp;		/* Slot to place it in */
+    struct dent **	nextvarp;	/* Next free variant slot */
+    {
+
+    *ndp = *wp;
+    while (wp->flagfield & MOREVARIANTS)
+	{
+	wp = wp->next;
+	ndp->next = *nextvarp;
+	ndp = (*nextvarp)++;
+	*ndp = *wp;
+	}
+    ndp->next = NULL;
     }
 
 #if MALLOC_INCREMENT == 0
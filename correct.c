@@ -226,6 +226,79 @@ static char Rcs_Id[] =
 #include "msgs.h"
 #include "version.h"
 
+/*
+** The generators of near misses collect their candidates in batches, so
+** that the dictionary lookups for a whole batch can overlap (see
+** lookupbatch) before goodent() judges each candidate in turn.  Only
+** the uppercase form of a candidate is kept:  good() ignores case when
+** asked for all hits, as the generators do, and ins_cap() takes the
+** capitalization from the dictionary and the misspelled word.
+*/
+struct candbatch
+    {
+    int		ncands;			/* Number of candidates in batch */
+    ichar_t	cands[LOOKUPBATCH][INPUTWORDLEN + MAXAFFIXLEN];
+					/* Candidates, in uppercase */
+    ichar_t *	candp[LOOKUPBATCH];	/* Pointers to cands, for lookup */
+    int		lens[LOOKUPBATCH];	/* Lengths of candidates */
+    struct dent *
+		roots[LOOKUPBATCH];	/* What lookup found for each */
+    };
+
+/*
+** When the dictionary has a near-miss index (buildhash -n), the words
+** one edit from a misspelling are looked up in the index rather than
+** generated and tried one by one.  Each word found is given a key
+** saying where in the sequence of candidates the generators would have
+** produced it, so the suggestions can be offered in the same order.
+*/
+struct nearcand
+    {
+    long		key;		/* Where it would be generated */
+    unsigned char *	word;		/* The word, as a canonical string */
+    };
+
+struct nearset
+    {
+    ichar_t *		word;		/* Misspelling, in uppercase */
+    int			len;		/* Length of word */
+    int			ncands;		/* No. candidates, or more if full */
+    int			next;		/* Next candidate to try */
+    struct nearcand	cands[MAXNEARMISSES];
+					/* Candidates found so far */
+    };
+
+/*
+** When the easier changes find nothing, -E is given, and the dictionary
+** has a trie, words up to MAXFARDIST edits from the misspelling are
+** looked for by
+** following the trie, keeping a row of the edit-distance table for each
+** node on the path (in effect, running a Levenshtein automaton over
+** the trie).  A path is abandoned as soon as no word below it can be
+** close enough.  Each trie node visited counts as one check against
+** the budget.
+*/
+#define MAXFARDIST	2	/* Most edits for a far miss */
+
+struct farset
+    {
+    ichar_t *		word;		/* Misspelling, in uppercase */
+    int			len;		/* Length of word */
+    int			ncands;		/* Number of candidates found */
+    int			maxdist;	/* Most edits wanted on this pass */
+    int			stopped;	/* NZ if the budget ran out */
+    ichar_t		path[INPUTWORDLEN + MAXAFFIXLEN];
+					/* Characters on path taken */
+    unsigned char	dist[INPUTWORDLEN + MAXAFFIXLEN]
+			  [INPUTWORDLEN + MAXAFFIXLEN];
+					/* Edit distances for each node */
+    unsigned char	canddist[MAXFARMISSES + 1];
+					/* Distance of each candidate */
+    ichar_t		cands[MAXFARMISSES + 1][INPUTWORDLEN + MAXAFFIXLEN];
+					/* Candidates found */
+    };
+
+#ifndef LIBISPELL
 void		givehelp P ((int interactive));
 void		checkfile P ((void));
 void		correct P ((unsigned char * ctok, int ctokl, ichar_t * itok,
@@ -238,17 +311,41 @@ static int	line_size P ((unsigned char * buf, unsigned char * bufend));
 static void	inserttoken P ((unsigned char * buf, unsigned char * start,
 		  unsigned char * tok, unsigned char ** curchar,
 		  int oktochange));
+#endif /* LIBISPELL */
 static int	posscmp P ((unsigned char * a, unsigned char * b));
 int		casecmp P ((unsigned char * a, unsigned char * b, int canonical));
 void		makepossibilities P ((ichar_t * word));
 int		inpossibilities P ((unsigned char * ctok));
+int		needinposs P ((ichar_t * word));
 static int	insert P ((ichar_t * word));
+static void	addcand P ((struct candbatch * batch, ichar_t * word));
+static int	trybatch P ((struct candbatch * batch, ichar_t * pattern));
+static int	spend P ((int n));
+static int	nearmisses P ((ichar_t * word));
+static void	nearadd P ((struct nearset * set, unsigned char * word));
+static void	neartree P ((struct dent * ent, VOID * arg));
+static long	nearkey P ((ichar_t * word, int len, ichar_t * cand));
+static int	nearcmp P ((struct nearcand * a, struct nearcand * b));
+static int	neartry P ((struct nearset * set, long upto, ichar_t * word));
+static long	nearorder P ((int kind, int pos, int t));
+static int	triemisses P ((ichar_t * word));
+static int	triecand P ((struct nearset * set, long key, ichar_t * cand,
+		  ichar_t * word));
+static int	triechild P ((int node, ichar_t ch));
+static int	trieword P ((int node, ichar_t * rest));
+static void	farmisses P ((ichar_t * word));
+static void	farwalk P ((struct farset * set, int node, int depth));
+static int	farrow P ((struct farset * set, int depth));
+static void	farcand P ((struct farset * set, int depth));
+static void	fartree P ((struct dent * ent, VOID * arg));
 static void	wrongcapital P ((ichar_t * word));
 static void	wrongletter P ((ichar_t * word));
 static void	extraletter P ((ichar_t * word));
 static void	missingletter P ((ichar_t * word));
 static void	missingspace P ((ichar_t * word));
 int		compoundgood P ((ichar_t * word, int pfxopts));
+static int	compoundsplit P ((ichar_t * word, int start, int len,
+		  int pfxopts, signed char * tailok));
 static void	transposedletter P ((ichar_t * word));
 static void	tryveryhard P ((ichar_t * word));
 static int	ins_cap P ((ichar_t * word, ichar_t * pattern));
@@ -264,6 +361,7 @@ static void	save_root_cap P ((ichar_t * word, ichar_t * pattern,
 		  struct flagent * sufent,
 		  ichar_t savearea[MAX_CAPS][INPUTWORDLEN + MAXAFFIXLEN],
 		  int * nsaved));
+#ifndef LIBISPELL
 static char *	get_line_from_user P ((char * buf, int bufsize));
 void		askmode P ((void));
 void		copyout P ((unsigned char ** cc, int cnt));
@@ -906,6 +1004,7 @@ static void inserttoken (buf, start, tok, curchar, oktochange)
     while ((*p++ = *q++) != '\0')
 	;
     }
+#endif /* LIBISPELL */
 
 static int posscmp (a, b)
     unsigned char *	a;
@@ -964,12 +1063,15 @@ void makepossibilities (word)
     register ichar_t *	word;
     {
     register int	i;
+    int			nearfound;	/* Near misses one change away */
 
     for (i = 0; i < MAXPOSSIBLE; i++)
 	possibilities[i][0] = 0;
     pcount = 0;
     maxposslen = 0;
     easypossibilities = 0;
+    budgetleft = suggestbudget > 0 ? suggestbudget : -1;
+    posstruncated = 0;
 
     wrongcapital (word);
 
@@ -980,20 +1082,31 @@ void makepossibilities (word)
  * thus, it was exactly backwards in the old version. -- PWP
  */
 
-    if (pcount < MAXPOSSIBLE)
-	missingletter (word);		/* omission */
-    if (pcount < MAXPOSSIBLE)
-	transposedletter (word);	/* transposition */
-    if (pcount < MAXPOSSIBLE)
-	extraletter (word);		/* insertion */
-    if (pcount < MAXPOSSIBLE)
-	wrongletter (word);		/* substitution */
+    if ((nearents == NULL  ||  treeaffixed  ||  nearmisses (word) < 0)
+      &&  (trienodes == NULL  ||  treeaffixed  ||  triemisses (word) < 0))
+	{
+	if (pcount < MAXPOSSIBLE)
+	    missingletter (word);	/* omission */
+	if (pcount < MAXPOSSIBLE)
+	    transposedletter (word);	/* transposition */
+	if (pcount < MAXPOSSIBLE)
+	    extraletter (word);		/* insertion */
+	if (pcount < MAXPOSSIBLE)
+	    wrongletter (word);		/* substitution */
+	}
 
     if ((compoundflag != COMPOUND_ANYTIME)  &&  pcount < MAXPOSSIBLE)
 	missingspace (word);	/* two words */
 
+    /*
+    ** Words two changes away (-E) are offered along with the guesses,
+    ** not instead of them.
+    */
+    nearfound = pcount;
+    if (nearfound == 0  &&  farflag  &&  trienodes != NULL)
+	farmisses (word);	/* two changes */
     easypossibilities = pcount;
-    if (easypossibilities == 0  ||  tryhardflag)
+    if (nearfound == 0  ||  tryhardflag)
 	tryveryhard (word);
 
     if ((sortit  ||  (pcount > easypossibilities))  &&  pcount)
@@ -1009,6 +1122,8 @@ void makepossibilities (word)
 	      sizeof (possibilities[0]),
 	      (int (*) P ((const void *, const void *))) posscmp);
 	}
+    if (posstruncated)
+	nposstruncated++;
     }
 
 int inpossibilities (ctok)
@@ -1083,6 +1198,27 @@ int inpossibilities (ctok)
     return 0;
     }
 
+/*
+ * Tell whether inpossibilities() could accept a word that good()
+ * rejected, so that callers who only want a verdict can skip
+ * generating the near misses when it can't.  The kludge only works
+ * when wrongletter() swaps one character for another that looks the
+ * same when printed, and two characters can only look the same if one
+ * of them is a string character.  Since strtoichar() always prefers a
+ * string character when the input could be read as one, the word must
+ * then contain one too.
+ */
+int needinposs (word)
+    register ichar_t *	word;
+    {
+    for (  ;  *word != 0;  word++)
+	{
+	if (*word >= SET_SIZE)
+	    return 1;
+	}
+    return 0;
+    }
+
 static int insert (word)
     register ichar_t *	word;
     {
@@ -1107,6 +1243,710 @@ static int insert (word)
 	return (0);
     }
 
+/* Add a candidate correction to a batch, which must not be full */
+static void addcand (batch, word)
+    register struct candbatch *
+			batch;		/* Batch to add to */
+    ichar_t *		word;		/* Candidate to add */
+    {
+    register ichar_t *	p;
+    register ichar_t *	q;
+
+    for (p = word, q = batch->cands[batch->ncands];  *p;  )
+	*q++ = mytoupper (*p++);
+    *q = 0;
+    batch->candp[batch->ncands] = batch->cands[batch->ncands];
+    batch->lens[batch->ncands] = q - batch->cands[batch->ncands];
+    batch->ncands++;
+    }
+
+/*
+** Look up all the candidates in a batch at once, then insert the good
+** ones, in order, as corrections of pattern.  Empties the batch.
+** Returns -1 if the table of possibilities fills up or the budget for
+** checks runs out.
+*/
+static int trybatch (batch, pattern)
+    register struct candbatch *
+			batch;		/* Batch of candidates to try */
+    ichar_t *		pattern;	/* Word they might correct */
+    {
+    register int	i;
+    int			n;
+
+    n = spend (batch->ncands);
+    lookupbatch (batch->candp, n, batch->roots, 1);
+    for (i = 0;  i < n;  i++)
+	{
+	if (goodent (batch->cands[i], batch->cands[i], batch->lens[i],
+	  batch->roots[i], 0, 1, 0, 0))
+	    {
+	    if (ins_cap (batch->cands[i], pattern) < 0)
+		return -1;
+	    }
+	}
+    i = batch->ncands;
+    batch->ncands = 0;
+    return n < i ? -1 : 0;
+    }
+
+/*
+** Charge n candidate checks against the budget for the current word
+** (see the -G switch).  Returns the number that may be made, which is
+** less than n, with the possibilities marked as cut short, once the
+** budget runs out.
+*/
+static int spend (n)
+    int			n;		/* Checks wanted */
+    {
+
+    if (budgetleft < 0)
+	return n;
+    if (n > budgetleft)
+	{
+	n = budgetleft;
+	posstruncated = 1;
+	}
+    budgetleft -= n;
+    return n;
+    }
+
+/*
+** Find the near misses of word that involve one omission,
+** transposition, insertion, or substitution by looking up its keys in
+** the near-miss index, and insert the good ones in the order that
+** missingletter, transposedletter, extraletter, and wrongletter would
+** have.  Affix flags in the personal dictionary would make words good
+** that aren't in the index, so the caller must not use this if there
+** are any.  Returns -1, having inserted nothing, if there are too many
+** near misses or the word is too long to have been indexed; the
+** caller must then generate the near misses the usual way.
+*/
+static int nearmisses (word)
+    ichar_t *		word;		/* Misspelled word */
+    {
+    register unsigned int
+			e;		/* Index of entry being checked */
+    unsigned int	fprint;		/* Fingerprint of key */
+    register int	i;
+    ichar_t		key[INPUTWORDLEN + MAXAFFIXLEN];
+					/* Key being looked up */
+    struct nearset	set;		/* Near misses found */
+    unsigned int	slot;		/* Slot for key */
+    ichar_t		upword[INPUTWORDLEN + MAXAFFIXLEN];
+					/* Word, in uppercase */
+
+    set.len = icharlen (word);
+    if (set.len >= INPUTWORDLEN)
+	return -1;
+    (void) icharcpy (upword, word);
+    upcase (upword);
+    set.word = upword;
+    set.ncands = 0;
+    /*
+    ** A word one edit away shares a key with this one:  either its own
+    ** or one of its deletions is the word itself or one of the word's
+    ** deletions.  The index files each word under all of those keys.
+    */
+    for (i = -1;  i < set.len;  i++)
+	{
+	if (i > 0  &&  upword[i] == upword[i - 1])
+	    continue;
+	(void) icharcpy (key, upword);
+	if (i >= 0)
+	    (void) icharcpy (key + i, upword + i + 1);
+	slot = hash (key, hashheader.nnearslots);
+	fprint = hashfprint (key);
+	for (e = nearslots[slot];  e < nearslots[slot + 1];  e++)
+	    {
+	    if (nearents[e].fprint == fprint)
+		nearadd (&set, nearstrings + nearents[e].word);
+	    }
+	}
+    treewalk (neartree, (VOID *) &set);
+    if (set.ncands > MAXNEARMISSES)
+	return -1;
+    qsort ((char *) set.cands, (unsigned) set.ncands,
+      sizeof (struct nearcand),
+      (int (*) P ((const void *, const void *))) nearcmp);
+    set.next = 0;
+    (void) neartry (&set, nearorder (4, 0, 0), word);
+    return 0;
+    }
+
+/*
+** Add a word to a set of near misses, if it is one edit from the
+** misspelling.  If the set is already full, just note that it has
+** overflowed.
+*/
+static void nearadd (set, word)
+    register struct nearset *
+			set;		/* Set to add to */
+    unsigned char *	word;		/* Possible near miss */
+    {
+    ichar_t		cand[INPUTWORDLEN + MAXAFFIXLEN];
+					/* Word as an ichar_t */
+    long		key;		/* Where word would be generated */
+
+    if (set->ncands > MAXNEARMISSES)
+	return;
+    if (strtoichar (cand, word, sizeof cand, 1))
+	return;
+    upcase (cand);
+    key = nearkey (set->word, set->len, cand);
+    if (key < 0)
+	return;
+    if (set->ncands == MAXNEARMISSES)
+	set->ncands++;
+    else
+	{
+	set->cands[set->ncands].key = key;
+	set->cands[set->ncands++].word = word;
+	}
+    }
+
+/*
+** Add a personal-dictionary word to a set of near misses, if it is one.
+** Called through treewalk.
+*/
+static void neartree (ent, arg)
+    struct dent *	ent;		/* Personal-dictionary entry */
+    VOID *		arg;		/* Set to add to */
+    {
+
+    nearadd ((struct nearset *) arg, (unsigned char *) ent->word);
+    }
+
+/*
+** Decide whether a candidate is one of the near misses of a word that
+** missingletter, transposedletter, extraletter, or wrongletter would
+** try, and if so, where among their candidates it would first come.
+** Both words must be in uppercase.  Returns a key that sorts the
+** candidates in the order they would be generated, or -1 if the
+** candidate would never be generated at all.
+*/
+static long nearkey (word, len, cand)
+    register ichar_t *	word;		/* Misspelled word */
+    int			len;		/* Length of word */
+    register ichar_t *	cand;		/* Candidate correction */
+    {
+    int			candlen;	/* Length of cand */
+    int			kind;		/* Which generator makes cand */
+    register int	pos;		/* Position of the edit */
+    int			prefix;		/* Length of common prefix */
+    int			suffix;		/* Length of common suffix */
+    register int	t;		/* Index into Try */
+
+    candlen = icharlen (cand);
+    for (prefix = 0;
+      prefix < len  &&  prefix < candlen  &&  word[prefix] == cand[prefix];
+      prefix++)
+	;
+    for (suffix = 0;
+      suffix < len  &&  suffix < candlen
+	&&  word[len - 1 - suffix] == cand[candlen - 1 - suffix];
+      suffix++)
+	;
+    t = 0;
+    if (candlen == len + 1)
+	{
+	/*
+	** Omission:  cand[pos] could have been inserted at any pos
+	** from len - suffix through prefix.  Missingletter tries
+	** positions in order, and each position with the characters of
+	** Try in order, except for boundary characters at the ends.
+	*/
+	kind = 0;
+	for (pos = len - suffix < 0 ? 0 : len - suffix;
+	  pos <= prefix;
+	  pos++)
+	    {
+	    for (t = 0;  t < Trynum;  t++)
+		{
+		if (mytoupper (Try[t]) == cand[pos]
+		  &&  (!isboundarych (Try[t])  ||  (pos != 0  &&  pos != len)))
+		    break;
+		}
+	    if (t < Trynum)
+		break;
+	    }
+	if (pos > prefix)
+	    return -1;
+	}
+    else if (candlen == len)
+	{
+	pos = prefix;
+	if (pos == len)
+	    return -1;		/* Wrongcapital has already tried it */
+	else if (suffix >= len - pos - 1)
+	    {
+	    /* Substitution, which wrongletter tries after the rest */
+	    kind = 3;
+	    for (t = 0;  t < Trynum;  t++)
+		{
+		if (mytoupper (Try[t]) == cand[pos]
+		  &&  (!isboundarych (Try[t])  ||  (pos != 0  &&  pos != len - 1)))
+		    break;
+		}
+	    if (t >= Trynum)
+		return -1;
+	    }
+	else if (suffix >= len - pos - 2
+	  &&  word[pos] == cand[pos + 1]  &&  word[pos + 1] == cand[pos])
+	    kind = 1;		/* Transposition */
+	else
+	    return -1;
+	}
+    else if (candlen == len - 1  &&  len >= 2)
+	{
+	/*
+	** Insertion:  any character from len - 1 - suffix through
+	** prefix could have been the extra one.  Extraletter tries
+	** deleting each in order.
+	*/
+	kind = 2;
+	pos = len - 1 - suffix < 0 ? 0 : len - 1 - suffix;
+	if (pos > prefix)
+	    return -1;
+	}
+    else
+	return -1;
+    return nearorder (kind, pos, t);
+    }
+
+/*
+** Make the key that puts a near miss in the order the generators
+** produce it:  kind is 0 for missingletter, 1 for transposedletter,
+** 2 for extraletter, and 3 for wrongletter, pos is the position of the
+** change, and t is the index in Try of the character used, if any.
+*/
+static long nearorder (kind, pos, t)
+    int			kind;		/* Which generator */
+    int			pos;		/* Position of change */
+    int			t;		/* Index into Try */
+    {
+
+    return ((long) kind * (INPUTWORDLEN + MAXAFFIXLEN + 1) + pos)
+      * (Trynum + 1) + t;
+    }
+
+/*
+** Compare two near misses for sorting into the order they would be
+** generated.
+*/
+static int nearcmp (a, b)
+    struct nearcand *	a;		/* First near miss */
+    struct nearcand *	b;		/* Second near miss */
+    {
+
+    if (a->key < b->key)
+	return -1;
+    else
+	return a->key > b->key;
+    }
+
+/*
+** Try the near misses in a set, in order, up to (but not including)
+** those with key upto, inserting the good ones.  Equal keys are the
+** same word, found more than once, and are tried only once.  Returns
+** -1 if the table of possibilities fills up or the budget runs out.
+*/
+static int neartry (set, upto, word)
+    register struct nearset *
+			set;		/* Near misses to try */
+    long		upto;		/* Key to stop at */
+    ichar_t *		word;		/* Misspelled word */
+    {
+    ichar_t		cand[INPUTWORDLEN + MAXAFFIXLEN];
+					/* Candidate being tried */
+    register int	i;
+
+    for (  ;  set->next < set->ncands;  set->next++)
+	{
+	i = set->next;
+	if (set->cands[i].key >= upto)
+	    break;
+	if (i > 0  &&  set->cands[i].key == set->cands[i - 1].key)
+	    continue;
+	if (spend (1) == 0)
+	    return -1;
+	(void) strtoichar (cand, set->cands[i].word, sizeof cand, 1);
+	upcase (cand);
+	if (good (cand, 0, 1, 0, 0)  &&  ins_cap (cand, word) < 0)
+	    return -1;
+	}
+    return 0;
+    }
+
+/*
+** Find the near misses of word that involve one omission,
+** transposition, insertion, or substitution by following the word's
+** path through the dictionary trie.  The candidates are made in the
+** same order as by missingletter, transposedletter, extraletter, and
+** wrongletter, but one is only tried if it is in the trie, and the
+** path for all candidates that change the word past a point the
+** trie can't reach is never followed at all.  Words in the personal
+** dictionary aren't in the trie, so they are found as by nearmisses,
+** and tried among the rest in their proper places.  Returns -1,
+** having inserted nothing, if the personal dictionary has too many
+** near misses of the word.
+*/
+static int triemisses (word)
+    ichar_t *		word;		/* Misspelled word */
+    {
+    ichar_t		cand[INPUTWORDLEN + MAXAFFIXLEN + 1];
+					/* Candidate being tried */
+    register int	i;
+    int			len;		/* Length of word */
+    int			node;		/* Node reached by a change */
+    int			path[INPUTWORDLEN + MAXAFFIXLEN + 1];
+					/* Node for each prefix of word */
+    struct nearset	set;		/* Near misses in personal dict */
+    register int	t;		/* Index into Try */
+    ichar_t		upword[INPUTWORDLEN + MAXAFFIXLEN];
+					/* Word, in uppercase */
+
+    len = icharlen (word);
+    (void) icharcpy (upword, word);
+    upcase (upword);
+    set.word = upword;
+    set.len = len;
+    set.ncands = 0;
+    treewalk (neartree, (VOID *) &set);
+    if (set.ncands > MAXNEARMISSES)
+	return -1;
+    qsort ((char *) set.cands, (unsigned) set.ncands,
+      sizeof (struct nearcand),
+      (int (*) P ((const void *, const void *))) nearcmp);
+    set.next = 0;
+    /*
+    ** Path[i] is the node reached by the first i characters of the
+    ** word, or -1 if they aren't the start of any word.
+    */
+    path[0] = 0;
+    for (i = 0;  i < len;  i++)
+	path[i + 1] = path[i] < 0 ? -1 : triechild (path[i], upword[i]);
+
+    /* Omissions, as in missingletter */
+    (void) icharcpy (cand + 1, upword);
+    for (i = 0;  i <= len  &&  path[i] >= 0;  i++)
+	{
+	for (t = 0;  t < Trynum;  t++)
+	    {
+	    if (isboundarych (Try[t])  &&  (i == 0  ||  i == len))
+		continue;
+	    node = triechild (path[i], mytoupper (Try[t]));
+	    if (node < 0  ||  !trieword (node, &upword[i]))
+		continue;
+	    cand[i] = mytoupper (Try[t]);
+	    if (triecand (&set, nearorder (0, i, t), cand, word) < 0)
+		return 0;
+	    }
+	cand[i] = upword[i];
+	}
+
+    /* Transpositions, as in transposedletter */
+    (void) icharcpy (cand, upword);
+    for (i = 0;  i + 1 < len  &&  path[i] >= 0;  i++)
+	{
+	node = triechild (path[i], upword[i + 1]);
+	if (node >= 0)
+	    node = triechild (node, upword[i]);
+	if (node < 0  ||  !trieword (node, &upword[i + 2]))
+	    continue;
+	cand[i] = upword[i + 1];
+	cand[i + 1] = upword[i];
+	if (triecand (&set, nearorder (1, i, 0), cand, word) < 0)
+	    return 0;
+	cand[i] = upword[i];
+	cand[i + 1] = upword[i + 1];
+	}
+
+    /* Insertions, as in extraletter */
+    for (i = 0;  len >= 2  &&  i < len  &&  path[i] >= 0;  i++)
+	{
+	if (!trieword (path[i], &upword[i + 1]))
+	    continue;
+	(void) icharcpy (cand, upword);
+	(void) icharcpy (cand + i, upword + i + 1);
+	if (triecand (&set, nearorder (2, i, 0), cand, word) < 0)
+	    return 0;
+	}
+
+    /* Substitutions, as in wrongletter */
+    (void) icharcpy (cand, upword);
+    for (i = 0;  i < len  &&  path[i] >= 0;  i++)
+	{
+	for (t = 0;  t < Trynum;  t++)
+	    {
+	    if (Try[t] == upword[i])
+		continue;
+	    else if (isboundarych (Try[t])  &&  (i == 0  ||  i == len - 1))
+		continue;
+	    node = triechild (path[i], mytoupper (Try[t]));
+	    if (node < 0  ||  !trieword (node, &upword[i + 1]))
+		continue;
+	    cand[i] = mytoupper (Try[t]);
+	    if (triecand (&set, nearorder (3, i, t), cand, word) < 0)
+		return 0;
+	    }
+	cand[i] = upword[i];
+	}
+    (void) neartry (&set, nearorder (4, 0, 0), word);
+    return 0;
+    }
+
+/*
+** Try a candidate found in the trie, after any near misses from the
+** personal dictionary that come before it.  Returns -1 if the table of
+** possibilities fills up or the budget runs out.
+*/
+static int triecand (set, key, cand, word)
+    struct nearset *	set;		/* Personal-dictionary near misses */
+    long		key;		/* Where cand is generated */
+    ichar_t *		cand;		/* Candidate, in uppercase */
+    ichar_t *		word;		/* Misspelled word */
+    {
+
+    if (neartry (set, key, word) < 0  ||  spend (1) == 0)
+	return -1;
+    if (good (cand, 0, 1, 0, 0)  &&  ins_cap (cand, word) < 0)
+	return -1;
+    return 0;
+    }
+
+/*
+** Find the child of a trie node that is reached by ch.  Returns its
+** index, or -1 if there is none.
+*/
+static int triechild (node, ch)
+    int			node;		/* Node to search */
+    register ichar_t	ch;		/* Character to look for */
+    {
+    register struct trienode *
+			kid;		/* Child being checked */
+    register struct trienode *
+			endkid;		/* End of children */
+
+    kid = &trienodes[trienodes[node].kids];
+    for (endkid = kid + trienodes[node].nkids;  kid < endkid;  kid++)
+	{
+	if (kid->ch == ch)
+	    return kid - trienodes;
+	}
+    return -1;
+    }
+
+/*
+** Follow the rest of a word down the trie from a node, and see whether
+** it ends at the end of a dictionary word.
+*/
+static int trieword (node, rest)
+    register int	node;		/* Node to start from */
+    register ichar_t *	rest;		/* Rest of word */
+    {
+
+    for (  ;  *rest != 0;  rest++)
+	{
+	if ((node = triechild (node, *rest)) < 0)
+	    return 0;
+	}
+    return trienodes[node].nkids != 0
+      &&  trienodes[trienodes[node].kids].ch == 0;
+    }
+
+/*
+** Find words up to MAXFARDIST edits from word, counting the
+** transposition of two adjacent characters as a single edit, and
+** insert the good ones:  first those one edit away (which can still be
+** missed by the generators if Try lacks a character), and then the
+** rest.  The trie is searched once for each distance, nearest first,
+** so that words two edits away can't crowd out closer ones.  At most
+** MAXFARMISSES words are found.  Words from the personal dictionary,
+** which aren't in the trie, are checked first.
+*/
+static void farmisses (word)
+    ichar_t *		word;		/* Misspelled word */
+    {
+    int			dist;		/* Distance being inserted */
+    register int	i;
+    struct farset	set;		/* Words found */
+    ichar_t		upword[INPUTWORDLEN + MAXAFFIXLEN];
+					/* Word, in uppercase */
+
+    set.len = icharlen (word);
+    if (MAXFARMISSES <= 0
+      ||  set.len + MAXFARDIST >= INPUTWORDLEN + MAXAFFIXLEN)
+	return;
+    (void) icharcpy (upword, word);
+    upcase (upword);
+    set.word = upword;
+    set.ncands = 0;
+    set.stopped = 0;
+    for (i = 0;  i <= set.len;  i++)
+	set.dist[0][i] = i > MAXFARDIST ? MAXFARDIST + 1 : i;
+    for (set.maxdist = 1;
+      set.maxdist <= MAXFARDIST  &&  set.ncands < MAXFARMISSES
+	&&  !set.stopped;
+      set.maxdist++)
+	{
+	treewalk (fartree, (VOID *) &set);
+	farwalk (&set, 0, 0);
+	}
+    for (dist = 1;  dist <= MAXFARDIST;  dist++)
+	{
+	for (i = 0;  i < set.ncands;  i++)
+	    {
+	    if (set.canddist[i] != dist)
+		continue;
+	    if (spend (1) == 0)
+		return;
+	    if (good (set.cands[i], 0, 1, 0, 0)
+	      &&  ins_cap (set.cands[i], word) < 0)
+		return;
+	    }
+	}
+    }
+
+/*
+** Follow the trie down from a node, reached by the depth characters
+** in set->path, collecting the words within set->maxdist edits of the
+** misspelling.
+*/
+static void farwalk (set, node, depth)
+    register struct farset *
+			set;		/* Words found so far */
+    int			node;		/* Node reached */
+    int			depth;		/* Depth of node */
+    {
+    register struct trienode *
+			kid;		/* Child being followed */
+    struct trienode *	endkid;		/* End of children */
+
+    kid = &trienodes[trienodes[node].kids];
+    for (endkid = kid + trienodes[node].nkids;
+      kid < endkid  &&  set->ncands < MAXFARMISSES  &&  !set->stopped;
+      kid++)
+	{
+	if (kid->ch == 0)
+	    {
+	    if (set->dist[depth][set->len] <= set->maxdist)
+		farcand (set, depth);
+	    }
+	else if (depth + 1 < INPUTWORDLEN + MAXAFFIXLEN - 1)
+	    {
+	    if (spend (1) == 0)
+		{
+		set->stopped = 1;
+		return;
+		}
+	    set->path[depth] = kid->ch;
+	    if (farrow (set, depth + 1) <= set->maxdist)
+		farwalk (set, kid - trienodes, depth + 1);
+	    }
+	}
+    }
+
+/*
+** Fill in the row of edit distances for a path of the given depth,
+** from the rows above it:  set->dist[depth][i] is the distance from
+** the first i characters of the misspelling to the path, limited to
+** MAXFARDIST + 1.  Returns the smallest distance in the row;  if that
+** is too big, no longer path can be close enough either.
+*/
+static int farrow (set, depth)
+    register struct farset *
+			set;		/* Misspelling and path */
+    int			depth;		/* Length of path */
+    {
+    register unsigned char *
+			row;		/* Row being filled in */
+    register unsigned char *
+			above;		/* Row for path one shorter */
+    register int	best;		/* Smallest distance in row */
+    register ichar_t	ch;		/* Last character of path */
+    register int	d;		/* Distance being computed */
+    register int	i;
+
+    row = set->dist[depth];
+    above = set->dist[depth - 1];
+    ch = set->path[depth - 1];
+    best = row[0] = depth > MAXFARDIST ? MAXFARDIST + 1 : depth;
+    for (i = 1;  i <= set->len;  i++)
+	{
+	d = above[i - 1] + (set->word[i - 1] != ch);
+	if (above[i] + 1 < d)
+	    d = above[i] + 1;
+	if (row[i - 1] + 1 < d)
+	    d = row[i - 1] + 1;
+	if (depth > 1  &&  i > 1  &&  set->word[i - 1] == set->path[depth - 2]
+	  &&  set->word[i - 2] == ch
+	  &&  set->dist[depth - 2][i - 2] + 1 < d)
+	    d = set->dist[depth - 2][i - 2] + 1;
+	if (d > MAXFARDIST)
+	    d = MAXFARDIST + 1;
+	row[i] = d;
+	if (d < best)
+	    best = d;
+	}
+    return best;
+    }
+
+/*
+** Add the word spelled by set->path to the candidates, unless it is
+** the misspelling itself (which wrongcapital has tried) or has
+** already been found.
+*/
+static void farcand (set, depth)
+    register struct farset *
+			set;		/* Words found so far */
+    int			depth;		/* Length of word */
+    {
+    register int	i;
+
+    if (set->dist[depth][set->len] == 0  ||  set->ncands >= MAXFARMISSES)
+	return;
+    set->path[depth] = 0;
+    for (i = 0;  i < set->ncands;  i++)
+	{
+	if (icharcmp (set->cands[i], set->path) == 0)
+	    return;
+	}
+    (void) icharcpy (set->cands[set->ncands], set->path);
+    set->canddist[set->ncands++] = set->dist[depth][set->len];
+    }
+
+/*
+** Add a personal-dictionary word to the far misses, if it is one.
+** Called through treewalk.
+*/
+static void fartree (ent, arg)
+    struct dent *	ent;		/* Personal-dictionary entry */
+    VOID *		arg;		/* Words found so far */
+    {
+    register struct farset *
+			set;		/* Words found so far */
+    ichar_t		cand[INPUTWORDLEN + MAXAFFIXLEN];
+					/* Word as an ichar_t */
+    register int	depth;		/* Characters of word checked */
+
+    set = (struct farset *) arg;
+    if (set->ncands >= MAXFARMISSES
+      ||  strtoichar (cand, (unsigned char *) ent->word, sizeof cand, 1))
+	return;
+    upcase (cand);
+    for (depth = 0;  cand[depth] != 0;  depth++)
+	{
+	if (depth + 1 >= INPUTWORDLEN + MAXAFFIXLEN - 1)
+	    return;
+	set->path[depth] = cand[depth];
+	if (farrow (set, depth + 1) > set->maxdist)
+	    return;
+	}
+    if (set->dist[depth][set->len] <= set->maxdist)
+	farcand (set, depth);
+    }
+
 static void wrongcapital (word)
     register ichar_t *	word;
     {
@@ -1117,7 +1957,7 @@ static void wrongcapital (word)
     ** case.  If the word matches this way, "ins_cap" will recapitalize
     ** it correctly.
     */
-    if (good (word, 0, 1, 0, 0))
+    if (spend (1) != 0  &&  good (word, 0, 1, 0, 0))
 	{
 	(void) icharcpy (newword, word);
 	upcase (newword);
@@ -1133,11 +1973,13 @@ static void wrongletter (word)
     register int	n;
     ichar_t		savechar;
     ichar_t		newword[INPUTWORDLEN + MAXAFFIXLEN];
+    struct candbatch	batch;
 
     n = icharlen (word);
     (void) icharcpy (newword, word);
     upcase (newword);
 
+    batch.ncands = 0;
     for (i = 0; i < n; i++)
 	{
 	savechar = newword[i];
@@ -1148,14 +1990,13 @@ static void wrongletter (word)
 	    else if (isboundarych (Try[j])  &&  (i == 0  ||  i == n - 1))
 		continue;
 	    newword[i] = Try[j];
-	    if (good (newword, 0, 1, 0, 0))
-		{
-		if (ins_cap (newword, word) < 0)
-		    return;
-		}
+	    addcand (&batch, newword);
+	    if (batch.ncands == LOOKUPBATCH  &&  trybatch (&batch, word) < 0)
+		return;
 	    }
 	newword[i] = savechar;
 	}
+    (void) trybatch (&batch, word);
     }
 
 static void extraletter (word)
@@ -1164,20 +2005,21 @@ static void extraletter (word)
     ichar_t		newword[INPUTWORDLEN + MAXAFFIXLEN];
     register ichar_t *	p;
     register ichar_t *	r;
+    struct candbatch	batch;
 
     if (icharlen (word) < 2)
 	return;
 
+    batch.ncands = 0;
     (void) icharcpy (newword, word + 1);
     for (p = word, r = newword;  *p != 0;  )
 	{
-	if (good (newword, 0, 1, 0, 0))
-	    {
-	    if (ins_cap (newword, word) < 0)
-		return;
-	    }
+	addcand (&batch, newword);
+	if (batch.ncands == LOOKUPBATCH  &&  trybatch (&batch, word) < 0)
+	    return;
 	*r++ = *p++;
 	}
+    (void) trybatch (&batch, word);
     }
 
 static void missingletter (word)
@@ -1187,7 +2029,9 @@ static void missingletter (word)
     register ichar_t *	p;
     register ichar_t *	r;
     register int	i;
+    struct candbatch	batch;
 
+    batch.ncands = 0;
     (void) icharcpy (newword + 1, word);
     for (p = word, r = newword;  *p != 0;  )
 	{
@@ -1196,11 +2040,9 @@ static void missingletter (word)
 	    if (isboundarych (Try[i])  &&  r == newword)
 		continue;
 	    *r = Try[i];
-	    if (good (newword, 0, 1, 0, 0))
-		{
-		if (ins_cap (newword, word) < 0)
-		    return;
-		}
+	    addcand (&batch, newword);
+	    if (batch.ncands == LOOKUPBATCH  &&  trybatch (&batch, word) < 0)
+		return;
 	    }
 	*r++ = *p++;
 	}
@@ -1209,12 +2051,11 @@ static void missingletter (word)
 	if (isboundarych (Try[i]))
 	    continue;
 	*r = Try[i];
-	if (good (newword, 0, 1, 0, 0))
-	    {
-	    if (ins_cap (newword, word) < 0)
-		return;
-	    }
+	addcand (&batch, newword);
+	if (batch.ncands == LOOKUPBATCH  &&  trybatch (&batch, word) < 0)
+	    return;
 	}
+    (void) trybatch (&batch, word);
     }
 
 static void missingspace (word)
@@ -1244,6 +2085,8 @@ static void missingspace (word)
 	{
 	p[-1] = *p;
 	*p = '\0';
+	if (spend (1) == 0)
+	    return;
 	if (good (newword, 0, 1, 0, 0))
 	    {
 	    /*
@@ -1254,6 +2097,8 @@ static void missingspace (word)
 	     * problem.
 	     */
 	    nfirsthalf = save_cap (newword, word, firsthalf);
+	    if (spend (1) == 0)
+		return;
 	    if (good (p + 1, 0, 1, 0, 0))
 		{
 		nsecondhalf = save_cap (p + 1, p + 1, secondhalf);
@@ -1280,10 +2125,11 @@ int compoundgood (word, pfxopts)
     ichar_t *		word;
     int			pfxopts;	/* Options to apply to prefixes */
     {
+    int			i;
+    int			len;		/* Length of word */
     ichar_t		newword[INPUTWORDLEN + MAXAFFIXLEN];
-    register ichar_t *	p;
-    register ichar_t	savech;
-    long		secondcap;	/* Capitalization of 2nd half */
+    signed char		tailok[INPUTWORDLEN + MAXAFFIXLEN];
+					/* Verdicts on tails, -1 if unknown */
 
     /*
     ** If compoundflag is COMPOUND_NEVER, compound words are never ok.
@@ -1291,32 +2137,63 @@ int compoundgood (word, pfxopts)
     if (compoundflag == COMPOUND_NEVER)
 	return 0;
     /*
-    ** Test for a possible compound word (for languages like German that
-    ** form lots of compounds).
-    **
-    ** This is similar to missingspace, except we quit on the first hit,
-    ** and we won't allow either member of the compound to be a single
-    ** letter.
-    **
     ** We don't do words of length less than 2 * compoundmin, since
     ** both halves must at least compoundmin letters.
     */
-    if (icharlen (word) < 2 * hashheader.compoundmin)
+    len = icharlen (word);
+    if (len < 2 * hashheader.compoundmin)
 	return 0;
     (void) icharcpy (newword, word);
-    p = newword + hashheader.compoundmin;
-    for (  ;  p[hashheader.compoundmin - 1] != 0;  p++)
+    for (i = 0;  i <= len;  i++)
+	tailok[i] = -1;
+    return compoundsplit (newword, 0, len, pfxopts, tailok);
+    }
+
+/*
+** Test the part of a word that begins at "start" for being a compound
+** (for languages like German that form lots of compounds).
+**
+** This is similar to missingspace, except we quit on the first hit,
+** and we won't allow either member of the compound to be a single
+** letter.  The second member may itself be a compound, so the test
+** recurses on it.  Each tail of the word can follow many different
+** first members, though, and trying it again for each would make long
+** compounds take exponential time.  So whether a tail can end a
+** compound is found only once per word, and remembered in tailok.
+** The word is changed while it is tested, but is restored afterward.
+*/
+static int compoundsplit (word, start, len, pfxopts, tailok)
+    ichar_t *		word;		/* Whole word being tested */
+    int			start;		/* Start of the part to test */
+    int			len;		/* Length of whole word */
+    int			pfxopts;	/* Options to apply to prefixes */
+    signed char *	tailok;		/* Verdicts on tails of word */
+    {
+    register ichar_t *	p;
+    register ichar_t	savech;
+    long		secondcap;	/* Capitalization of 2nd half */
+    int			split;		/* Index of start of 2nd half */
+
+    if (len - start < 2 * hashheader.compoundmin)
+	return 0;
+    for (split = start + hashheader.compoundmin;
+      split + hashheader.compoundmin <= len;
+      split++)
 	{
+	p = &word[split];
 	savech = *p;
 	*p = 0;
-	if (good (newword, 0, 0, pfxopts, FF_COMPOUNDONLY))
+	if (good (&word[start], 0, 0, pfxopts, FF_COMPOUNDONLY))
 	    {
 	    *p = savech;
-	    if (good (p, 0, 1, FF_COMPOUNDONLY, 0)
-	      ||  compoundgood (p, FF_COMPOUNDONLY))
+	    if (tailok[split] < 0)
+		tailok[split] = good (p, 0, 1, FF_COMPOUNDONLY, 0)
+		  ||  compoundsplit (word, split, len, FF_COMPOUNDONLY,
+		    tailok);
+	    if (tailok[split])
 		{
 		secondcap = whatcap (p);
-		switch (whatcap (newword))
+		switch (whatcap (&word[start]))
 		    {
 		    case ANYCASE:
 		    case CAPITALIZED:
@@ -1339,28 +2216,31 @@ static void transposedletter (word)
     ichar_t		newword[INPUTWORDLEN + MAXAFFIXLEN];
     register ichar_t *	p;
     register ichar_t	temp;
+    struct candbatch	batch;
 
+    batch.ncands = 0;
     (void) icharcpy (newword, word);
     for (p = newword;  p[1] != 0;  p++)
 	{
 	temp = *p;
 	*p = p[1];
 	p[1] = temp;
-	if (good (newword, 0, 1, 0, 0))
-	    {
-	    if (ins_cap (newword, word) < 0)
-		return;
-	    }
+	addcand (&batch, newword);
+	if (batch.ncands == LOOKUPBATCH  &&  trybatch (&batch, word) < 0)
+	    return;
 	temp = *p;
 	*p = p[1];
 	p[1] = temp;
 	}
+    (void) trybatch (&batch, word);
     }
 
 static void tryveryhard (word)
     ichar_t *		word;
     {
-    (void) good (word, 1, 0, 0, 0);
+
+    if (spend (1) != 0)
+	(void) good (word, 1, 0, 0, 0);
     }
 
 /* Insert one or more correctly capitalized versions of word */
@@ -1634,6 +2514,7 @@ static void save_root_cap (word, pattern, prestrip, preadd, sufstrip, sufadd,
     return;
     }
 
+#ifndef LIBISPELL
 static char * get_line_from_user (s, len)
     register char *	s;
     register int	len;
@@ -1709,6 +2590,7 @@ void askmode ()
 			cp2;
     ichar_t *		itok;		/* Ichar version of current word */
     int			hadnl;		/* NZ if \n was at end of line */
+    int			lazy;		/* Lazyposs outside '?' lines */
 
     if (fflag)
 	{
@@ -1723,6 +2605,7 @@ void askmode ()
     (void) printf ("%s\n", Version_ID[0]);
 
     contextoffset = 0;
+    lazy = lazyposs;
     while (1)
 	{
 	if (askverbose)
@@ -1782,6 +2665,7 @@ void askmode ()
 	** `!' sets terse mode, `%' clears terse
 	** `~' followed by a filename sets parameters according to file name
 	** `^' causes rest of line to be checked after stripping 1st char
+	** `?' is like `^', but always gives near misses (see -q)
 	*/
 	if (askverbose  ||  contextoffset != 0)
 	    checkline (stdout);
@@ -1854,7 +2738,9 @@ void askmode ()
 		correct_verbose_mode = 1;
 	    else
 		{
-		if (filteredbuf[0] == '^')
+		if (filteredbuf[0] == '?')
+		    lazyposs = 0;
+		if (filteredbuf[0] == '^'  ||  filteredbuf[0] == '?')
 		    {
 		    /* Strip off leading uparrow */
 		    for (cp1 = filteredbuf, cp2 = filteredbuf + 1;
@@ -1868,7 +2754,10 @@ void askmode ()
 		}
 	    }
 	if (hadnl)
+	    {
 	    contextoffset = 0;
+	    lazyposs = lazy;
+	    }
 	else
 	    contextoffset += bufsize;
 #ifndef USG
@@ -2014,3 +2903,4 @@ static void regex_dict_lookup (cmd, grepstr)
     }
 
 #endif /* REGEX_LOOKUP */
+#endif /* LIBISPELL */
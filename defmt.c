@@ -213,10 +213,44 @@ static char Rcs_Id[] =
 #include "proto.h"
 #include "msgs.h"
 
+/*
+** In -a and -l modes, checkline() gathers the words of a line in
+** batches, so that their dictionary lookups can overlap (see
+** lookupbatch), and then reports on each word in turn.
+*/
+struct tokbatch
+    {
+    int		ntokens;		/* Number of words in batch */
+    unsigned char
+		ctoks[LOOKUPBATCH][INPUTWORDLEN + MAXAFFIXLEN];
+					/* Words, as given */
+    ichar_t	itoks[LOOKUPBATCH][INPUTWORDLEN + MAXAFFIXLEN];
+					/* Words, as ichar_t strings */
+    ichar_t	utoks[LOOKUPBATCH][INPUTWORDLEN + MAXAFFIXLEN];
+					/* Words, in uppercase */
+    ichar_t *	utokp[LOOKUPBATCH];	/* Words that need lookups */
+    int		lens[LOOKUPBATCH];	/* Lengths of words */
+    int		offsets[LOOKUPBATCH];	/* Offsets of words in the line */
+    struct dent *
+		dents[LOOKUPBATCH];	/* What lookup found for utokp */
+    int		verdicts[LOOKUPBATCH];	/* Verdicts on words, GOOD_xxx */
+    struct dent *
+		roots[LOOKUPBATCH];	/* Roots of GOOD_ROOT words */
+    };
+
 static unsigned char *
 		skiptoword P ((unsigned char * bufp));
 unsigned char *	skipoverword P ((unsigned char * bufp));
+static void	initscan P ((void));
 void		checkline P ((FILE * ofile));
+static void	addtoken P ((struct tokbatch * batch, unsigned char ** bufp,
+		  unsigned char * endp, int offset));
+static void	checkbatch P ((FILE * ofile, struct tokbatch * batch));
+static int	wordverdict P ((ichar_t * itok, ichar_t * utok, int ilen,
+		  struct dent * dp, struct dent ** rootp));
+static void	checktoken P ((FILE * ofile, unsigned char * ctok,
+		  ichar_t * itok, int verdict, struct dent * root,
+		  int offset));
 static int	TeX_math_end P ((unsigned char ** bufp));
 static int	TeX_math_begin P ((unsigned char ** bufp));
 static int	TeX_LR_begin P ((unsigned char ** bufp));
@@ -241,16 +275,21 @@ static int	tagcmp P ((unsigned char ** a, unsigned char ** b));
 			((c) == TEXDOLLAR) || \
 			((c) == TEXPERCENT))
 
-static int	    TeX_comment = 0;
-static int	    wordadjust;         /* Stringchar difference in word len */
+/*
+ * The deformatter's state is kept in the current checker context (see
+ * struct checkctx in ispell.h), so that several documents can be
+ * deformatted at once.
+ */
+#define TeX_comment	(curctx->c_texcomment)
+#define wordadjust	(curctx->c_wordadjust) /* Stringchar diff in word len */
 
 /*
  * The following variables are used to save the parsing state when
  * processing comments.  This allows comments to be parsed without
  * affecting the overall nesting.
  */
-static int save_math_mode;
-static char save_LaTeX_Mode;
+#define save_math_mode	(curctx->c_savemathmode)
+#define save_LaTeX_Mode	(curctx->c_savelatexmode)
 
 /*
  * The following variable indicates whether math mode was entered with
@@ -261,17 +300,83 @@ static char save_LaTeX_Mode;
  * single dollar.  Note that this is a kludge that breaks on illegal
  * syntax.
  */
-static unsigned int math_mode_dollars = 0;
+#define math_mode_dollars (curctx->c_mathdollars)
 
 /*
  * The following variables are used by the deformatter to keep
- * track of keywords that may indicate text to be ignored.
+ * track of keywords that may indicate text to be ignored.  Each
+ * context gets its own scratch buffer, long enough for the longest
+ * keyword, when it needs one.
  */
-static unsigned char *
-		keywordbuf;	/* Scratch buffer for keyword comparison */
+#define keywordbuf	(curctx->c_keywordbuf) /* Scratch for keyword cmps */
 static unsigned int
 		maxkeywordlen;	/* Length of longest keyword */
 
+/*
+ * Most bytes of plain text can be classified by looking at the byte
+ * alone, so skiptoword and skipoverword first run over those with a
+ * table lookup per byte, and only use the full tests for the rest.
+ * SCAN_SKIP bytes can never start a word, and SCAN_INWORD bytes always
+ * continue one, unless they begin a string character.  That is only
+ * possible for SCAN_STRING bytes, and then only if the next byte is
+ * in the byte's scanfollow bitmap.  Until initscan is called, no byte
+ * is in any class.  That only slows down the scanning loops, but
+ * addtoken relies on MAYBESTRING, so checkline calls initscan first.
+ */
+#define SCAN_SKIP	0x01	/* Byte is skipped by skiptoword */
+#define SCAN_INWORD	0x02	/* Byte is part of a word */
+#define SCAN_STRING	0x04	/* Byte might start a string character */
+
+#define MAYBESTRING(p)	((scanclass[*(p)] & SCAN_STRING) != 0 \
+			  &&  (scanfollow[*(p)][(p)[1] >> 3] \
+			    & (1 << ((p)[1] & 7))) != 0)
+
+static unsigned char
+		scanclass[SET_SIZE]; /* SCAN_xxx class of each byte */
+static unsigned char
+		scanfollow[SET_SIZE][SET_SIZE / 8];
+				/* Bytes that can follow a string start */
+static int	scaninited = 0;	/* NZ once scanclass is set up */
+
+/*
+ * Fill in scanclass and scanfollow from the hash file's character
+ * tables.
+ */
+static void initscan ()
+    {
+    register int	i;
+    register int	j;
+    unsigned char *	sp;
+
+    for (i = 1;  i < SET_SIZE;  i++)
+	{
+	scanclass[i] = 0;
+	if (isstringstart (i))
+	    scanclass[i] |= SCAN_STRING;
+	if (iswordch (chartoichar (i)))
+	    scanclass[i] |= SCAN_INWORD;
+	/*
+	 * A '0' might start a hex number, which skiptoword handles
+	 * specially.
+	 */
+	if ((!iswordch (chartoichar (i))  ||  isboundarych (chartoichar (i)))
+	  &&  i != '0')
+	    scanclass[i] |= SCAN_SKIP;
+	}
+    for (i = 0;  i < (int) hashheader.nstrchars;  i++)
+	{
+	sp = &hashheader.stringchars[i][0];
+	if (sp[1] == '\0')		/* One-byte string:  always a match */
+	    {
+	    for (j = 0;  j < SET_SIZE / 8;  j++)
+		scanfollow[sp[0]][j] = 0xff;
+	    }
+	else
+	    scanfollow[sp[0]][sp[1] >> 3] |= 1 << (sp[1] & 7);
+	}
+    scaninited = 1;
+    }
+
 static unsigned char * skiptoword (bufp) /* Skip to beginning of a word */
     unsigned char *	bufp;
     {
@@ -279,6 +384,11 @@ static unsigned char * skiptoword (bufp) /* Skip to beginning of a word */
     unsigned char *	htmlsubfield = bufp;
 					/* Ptr to start of subfield name */
 
+    if (tflag == DEFORMAT_NONE  &&  insidehtml == 0)
+	{
+	while ((scanclass[*bufp] & SCAN_SKIP)  &&  !MAYBESTRING (bufp))
+	    bufp++;
+	}
     while (*bufp
       &&  ((!isstringch (bufp, 0)  &&  !iswordch (chartoichar (*bufp)))
 	||  isboundarych (chartoichar (*bufp))
@@ -587,6 +697,11 @@ unsigned char * skipoverword (bufp) /* Return pointer to end of a word */
     wordadjust = 0;
     for (  ;  ;  )
 	{
+	while ((scanclass[*bufp] & SCAN_INWORD)  &&  !MAYBESTRING (bufp))
+	    {
+	    bufp++;
+	    lastboundary = NULL;
+	    }
 	if (*bufp == '\0')
 	    {
 	    if (TeX_comment)
@@ -643,10 +758,12 @@ void checkline (ofile)
 			endp;
     int			hadlf;
     register int	len;
-    register int	i;
-    int			ilen;
     unsigned char *	wordstart;      /* Where current word started */
+    struct tokbatch	batch;		/* Words waiting to be checked */
 
+    if (!scaninited)
+	initscan ();
+    batch.ntokens = 0;
     currentchar = filteredbuf;
     len = strlen ((char *) filteredbuf) - 1;
     hadlf = filteredbuf[len] == '\n';
@@ -717,167 +834,317 @@ void checkline (ofile)
 	if (*currentchar == 0)
 	    break;
 
-	p = ctoken;
 	endp = skipoverword (currentchar);
+	if (aflag  ||  lflag)
+	    {
+	    addtoken (&batch, &currentchar, endp,
+	      (int) (wordstart - filteredbuf + contextoffset));
+	    if (batch.ntokens == LOOKUPBATCH)
+		checkbatch (ofile, &batch);
+	    continue;
+	    }
+	p = ctoken;
 	while (currentchar < endp  &&  p < ctoken + sizeof ctoken - 1)
 	    *p++ = *currentchar++;
 	*p = 0;
 	if (strtoichar (itoken, ctoken, INPUTWORDLEN * sizeof (ichar_t), 0))
 	    (void) fprintf (stderr, WORD_TOO_LONG ((char *) ctoken));
-	ilen = icharlen (itoken);
+	if (!quit)
+	    correct (ctoken, sizeof ctoken, itoken, sizeof itoken,
+	      &currentchar);
+	(void) fprintf (ofile, "%s", (char *) ctoken);
+	}
+    checkbatch (ofile, &batch);
+
+    if (!lflag  &&  hadlf)
+       (void) putc ('\n', ofile);
+   }
+
+/*
+** Add the word from *bufp to endp to a batch of words, and advance
+** *bufp past it.  This does the work of copying the word to ctoken and
+** converting it with strtoichar, but it converts straight into the
+** batch and makes the uppercase form in the same pass.  A word too
+** long for ctoken is split, just as it would be there.
+*/
+static void addtoken (batch, bufp, endp, offset)
+    register struct tokbatch *
+			batch;		/* Batch to add to */
+    unsigned char **	bufp;		/* Start of word; updated */
+    unsigned char *	endp;		/* End of word */
+    int			offset;		/* Offset of word in the line */
+    {
+    register unsigned char *
+			in;
+    register ichar_t *	ip;
+    register ichar_t *	up;
+    register unsigned int
+			ch;
+    int			len;
+    int			outlen;
+    unsigned char *	ctok;
+    int			n;
+
+    n = batch->ntokens++;
+    ctok = batch->ctoks[n];
+    for (in = *bufp;
+      in < endp  &&  ctok < batch->ctoks[n] + sizeof batch->ctoks[0] - 1;
+      )
+	*ctok++ = *in++;
+    *ctok = '\0';
+    *bufp = in;
+    ip = batch->itoks[n];
+    up = batch->utoks[n];
+    for (in = batch->ctoks[n], outlen = INPUTWORDLEN;
+      --outlen > 0  &&  *in != '\0';
+      in += len)
+	{
+	if (!MAYBESTRING (in))
+	    {
+	    ch = *in;
+	    len = 1;
+	    }
+	else if (l1_isstringch (in, len, 0))
+	    ch = SET_SIZE + laststringch;
+	else
+	    ch = *in;
+	*ip++ = ch;
+	*up++ = mytoupper (ch);
+	}
+    *ip = 0;
+    *up = 0;
+    if (outlen <= 0)
+	(void) fprintf (stderr, WORD_TOO_LONG ((char *) batch->ctoks[n]));
+    batch->lens[n] = up - batch->utoks[n];
+    batch->offsets[n] = offset;
+    }
 
-	if (lflag)
+/*
+** Look up all the words in a batch at once, then report on each in
+** order.  Words whose verdicts are in the word cache (see
+** goodcachelookup) need no lookup.  Empties the batch.
+*/
+static void checkbatch (ofile, batch)
+    FILE *		ofile;		/* Where to report */
+    register struct tokbatch *
+			batch;		/* Batch of words to check */
+    {
+    register int	i;
+    register int	j;
+    int			n;
+    int			nlook;
+
+    n = batch->ntokens;
+    batch->ntokens = 0;
+    if (cflag)
+	{
+	/*
+	** There's no dictionary to look in; good() just prints the
+	** affix expansions of each word.
+	*/
+	for (i = 0;  i < n;  i++)
 	    {
-	    if (ilen > minword
-	      &&  !good (itoken, 0, 0, 0, 0)
-	      &&  !cflag  &&  !compoundgood (itoken, 0))
-		(void) fprintf (ofile, "%s\n", (char *) ctoken);
+	    if (batch->lens[i] > minword)
+		(void) good (batch->itoks[i], 0, 0, 0, 0);
 	    }
+	return;
+	}
+    for (i = 0, nlook = 0;  i < n;  i++)
+	{
+	if (batch->lens[i] <= minword)
+	    batch->verdicts[i] = GOOD_OK;
 	else
 	    {
-	    if (aflag)
+	    batch->verdicts[i] =
+	      goodcachelookup (batch->itoks[i], &batch->roots[i]);
+	    if (batch->verdicts[i] == GOOD_UNKNOWN)
+		batch->utokp[nlook++] = batch->utoks[i];
+	    }
+	}
+    lookupbatch (batch->utokp, nlook, batch->dents, 1);
+    for (i = 0, j = 0;  i < n;  i++)
+	{
+	if (batch->verdicts[i] == GOOD_UNKNOWN)
+	    {
+	    batch->verdicts[i] = wordverdict (batch->itoks[i],
+	      batch->utoks[i], batch->lens[i], batch->dents[j++],
+	      &batch->roots[i]);
+	    goodcacheenter (batch->itoks[i], batch->verdicts[i],
+	      batch->roots[i]);
+	    }
+	checktoken (ofile, batch->ctoks[i], batch->itoks[i],
+	  batch->verdicts[i], batch->roots[i], batch->offsets[i]);
+	}
+    }
+
+/*
+** Decide whether a word is spelled right, as -a and -l do.  Dp is what
+** lookup() found for utok, the uppercase form of the word.  Returns
+** GOOD_MISS, GOOD_OK, GOOD_ROOT, or GOOD_COMPOUND; for GOOD_ROOT,
+** *rootp gets the dictionary entry of the word's root.
+*/
+static int wordverdict (itok, utok, ilen, dp, rootp)
+    ichar_t *		itok;		/* Word, as an ichar_t string */
+    ichar_t *		utok;		/* Word, in uppercase */
+    int			ilen;		/* Length of the word */
+    struct dent *	dp;		/* Dictionary entry for utok */
+    struct dent **	rootp;		/* Where to put root's entry */
+    {
+
+    *rootp = NULL;
+    if (goodent (itok, utok, ilen, dp, 0, 0, 0, 0))
+	{
+	if (hits[0].prefix == NULL  &&  hits[0].suffix == NULL)
+	    return GOOD_OK;
+	*rootp = hits[0].dictent;
+	return GOOD_ROOT;
+	}
+    else if (compoundgood (itok, 0))
+	return GOOD_COMPOUND;
+    else
+	return GOOD_MISS;
+    }
+
+/*
+** Report on one word in -a or -l mode, given the verdict on it.
+*/
+static void checktoken (ofile, ctok, itok, verdict, root, offset)
+    FILE *		ofile;		/* Where to report */
+    unsigned char *	ctok;		/* Word, as given */
+    ichar_t *		itok;		/* Word, as an ichar_t string */
+    int			verdict;	/* Verdict on it, GOOD_xxx */
+    struct dent *	root;		/* Its root, if verdict is GOOD_ROOT */
+    int			offset;		/* Offset of word in the line */
+    {
+    register int	i;
+
+    if (lflag)
+	{
+	if (verdict == GOOD_MISS)
+	    (void) fprintf (ofile, "%s\n", (char *) ctok);
+	return;
+	}
+    if (verdict == GOOD_OK)
+	{
+	/* perfect match, or matched because of minword */
+	if (!terse)
+	    {
+	    if (askverbose)
+		(void) fprintf (ofile, "ok\n");
+	    else
 		{
-		if (ilen <= minword)
-		    {
-		    /* matched because of minword */
-		    if (!terse)
-			{
-			if (askverbose)
-			    (void) fprintf (ofile, "ok\n");
-			else
-			    {
-			    if (correct_verbose_mode)
-				(void) fprintf (ofile, "* %s\n", ctoken );
-			    else
-				(void) fprintf (ofile, "*\n");
-			    }
-			}
-		    continue;
-		    }
-		if (good (itoken, 0, 0, 0, 0))
-		    {
-		    if (hits[0].prefix == NULL
-		      &&  hits[0].suffix == NULL)
-			{
-			/* perfect match */
-			if (!terse)
-			    {
-			    if (askverbose)
-				(void) fprintf (ofile, "ok\n");
-			    else
-				{
-				if (correct_verbose_mode)
-				    (void) fprintf (ofile, "* %s\n", ctoken );
-				else
-				    (void) fprintf (ofile, "*\n");
-				}
-			    }
-			}
-		    else if (!terse)
-			{
-			/* matched because of root */
-			if (askverbose)
-			    (void) fprintf (ofile,
-			      "ok (derives from root %s)\n",
-			      (char *) hits[0].dictent->word);
-			else
-			    {
-			    if (correct_verbose_mode)
-				(void) fprintf (ofile, "+ %s %s\n",
-				  ctoken, hits[0].dictent->word);
-			    else
-				(void) fprintf (ofile, "+ %s\n",
-				  hits[0].dictent->word);
-			    }
-			}
-		    }
-		else if (compoundgood (itoken, 0))
-		    {
-		    /* compound-word match */
-		    if (!terse)
-			{
-			if (askverbose)
-			    (void) fprintf (ofile, "ok (compound word)\n");
-			else
-			    {
-			    if (correct_verbose_mode)
-				(void) fprintf (ofile, "- %s\n", ctoken);
-			    else
-				(void) fprintf (ofile, "-\n");
-			    }
-			}
-		    }
+		if (correct_verbose_mode)
+		    (void) fprintf (ofile, "* %s\n", ctok );
+		else
+		    (void) fprintf (ofile, "*\n");
+		}
+	    }
+	}
+    else if (verdict == GOOD_ROOT)
+	{
+	/* matched because of root */
+	if (!terse)
+	    {
+	    if (askverbose)
+		(void) fprintf (ofile,
+		  "ok (derives from root %s)\n", (char *) root->word);
+	    else
+		{
+		if (correct_verbose_mode)
+		    (void) fprintf (ofile, "+ %s %s\n", ctok, root->word);
+		else
+		    (void) fprintf (ofile, "+ %s\n", root->word);
+		}
+	    }
+	}
+    else if (verdict == GOOD_COMPOUND)
+	{
+	/* compound-word match */
+	if (!terse)
+	    {
+	    if (askverbose)
+		(void) fprintf (ofile, "ok (compound word)\n");
+	    else
+		{
+		if (correct_verbose_mode)
+		    (void) fprintf (ofile, "- %s\n", ctok);
+		else
+		    (void) fprintf (ofile, "-\n");
+		}
+	    }
+	}
+    else if (lazyposs  &&  !askverbose  &&  !needinposs (itok))
+	{
+	/*
+	** Report the misspelling without any near misses;  the caller
+	** can ask for them with a '?' line if it wants them.  Words that
+	** inpossibilities() might still accept go the long way round.
+	*/
+	(void) fprintf (ofile, "& %s 0 %d:\n", (char *) ctok, offset);
+	}
+    else
+	{
+	makepossibilities (itok);
+	if (inpossibilities (ctok)) /* Kludge for German, etc. */
+	    {
+	    /* might not be perfect match, but we'll lie */
+	    if (!terse)
+		{
+		if (askverbose)
+		    (void) fprintf (ofile, "ok\n");
 		else
 		    {
-		    makepossibilities (itoken);
-		    if (inpossibilities (ctoken)) /* Kludge for German, etc. */
-			{
-			/* might not be perfect match, but we'll lie */
-			if (!terse)
-			    {
-			    if (askverbose)
-				(void) fprintf (ofile, "ok\n");
-			    else
-				{
-				if (correct_verbose_mode)
-				    (void) fprintf (ofile, "* %s\n", ctoken );
-				else
-				    (void) fprintf (ofile, "*\n");
-				}
-			    }
-			}
-		    else if (pcount)
-			{
-			/*
-			** print &  or ?, ctoken, then
-			** character offset, possibility
-			** count, and the possibilities.
-			*/
-			if (askverbose)
-			    (void) fprintf (ofile, "how about");
-			else
-			    (void) fprintf (ofile, "%c %s %d %d",
-			      easypossibilities ? '&' : '?',
-			      (char *) ctoken,
-			      easypossibilities,
-			      (int) (wordstart - filteredbuf + contextoffset));
-			for (i = 0;  i < MAXPOSSIBLE;  i++)
-			    {
-			    if (possibilities[i][0] == 0)
-				break;
-			    (void) fprintf (ofile, "%c %s",
-			      i ? ',' : ':', possibilities[i]);
-			    }
-			(void) fprintf (ofile, "\n");
-			}
+		    if (correct_verbose_mode)
+			(void) fprintf (ofile, "* %s\n", ctok );
 		    else
-			{
-			/*
-			** No possibilities found for word TOKEN
-			*/
-			if (askverbose)
-			    (void) fprintf (ofile, "not found\n");
-			else
-			    (void) fprintf (ofile, "# %s %d\n",
-			      (char *) ctoken,
-			      (int) (wordstart - filteredbuf + contextoffset));
-			}
+			(void) fprintf (ofile, "*\n");
 		    }
 		}
+	    }
+	else if (pcount)
+	    {
+	    /*
+	    ** print &  or ?, ctok, then
+	    ** character offset, possibility
+	    ** count, and the possibilities.
+	    */
+	    if (askverbose)
+		(void) fprintf (ofile, "how about");
 	    else
+		(void) fprintf (ofile, "%c %s %d %d",
+		  easypossibilities ? '&' : '?',
+		  (char *) ctok,
+		  easypossibilities, offset);
+	    for (i = 0;  i < MAXPOSSIBLE;  i++)
 		{
-		if (!quit)
-		   correct (ctoken, sizeof ctoken, itoken, sizeof itoken,
-		     &currentchar);
+		if (possibilities[i][0] == 0)
+		    break;
+		(void) fprintf (ofile, "%c %s",
+		  i ? ',' : ':', possibilities[i]);
 		}
+	    /*
+	    ** If the -G budget cut the search short, say that there
+	    ** may be more.
+	    */
+	    if (posstruncated)
+		(void) fprintf (ofile, ", ...");
+	    (void) fprintf (ofile, "\n");
+	    }
+	else
+	    {
+	    /*
+	    ** No possibilities found for word TOKEN
+	    */
+	    if (askverbose)
+		(void) fprintf (ofile, posstruncated ? "not found ...\n"
+		  : "not found\n");
+	    else if (posstruncated)
+		(void) fprintf (ofile, "# %s %d ...\n", (char *) ctok, offset);
+	    else
+		(void) fprintf (ofile, "# %s %d\n", (char *) ctok, offset);
 	    }
-	if (!aflag  &&  !lflag)
-	   (void) fprintf (ofile, "%s", (char *) ctoken);
 	}
-
-    if (!lflag  &&  hadlf)
-       (void) putc ('\n', ofile);
-   }
+    }
 
 /* must check for \begin{mbox} or whatever makes new text region. */
 static int TeX_math_end (bufp)
@@ -1401,18 +1668,7 @@ int init_keyword_table (rawtags, envvar, deftags, ignorecase, keywords)
       (int (*) P ((const void *, const void *))) tagcmp);
   
     if (keywords->maxlen > maxkeywordlen)
-	{
 	maxkeywordlen = keywords->maxlen;
-	if (keywordbuf != NULL)
-	    free (keywordbuf);
-	keywordbuf = (unsigned char *)
-	  malloc ((maxkeywordlen + 1) * sizeof keywordbuf[0]);
-	if (keywordbuf == NULL)
-	    {
-	    fprintf (stderr, DEFMT_C_NO_SPACE, MAYBE_CR (stderr));
-	    exit(1);
-	    }
-	}
     return 0;
     }
 
@@ -1440,6 +1696,19 @@ static int keyword_in_list (str, strend, keywords)
     i = strend - str;
     if (i < keywords->minlen  ||  i > keywords->maxlen)
 	return 0;
+    if (curctx->c_keywordbufsize <= maxkeywordlen)
+	{
+	if (keywordbuf != NULL)
+	    free (keywordbuf);
+	curctx->c_keywordbufsize = maxkeywordlen + 1;
+	keywordbuf = (unsigned char *)
+	  malloc ((maxkeywordlen + 1) * sizeof keywordbuf[0]);
+	if (keywordbuf == NULL)
+	    {
+	    fprintf (stderr, DEFMT_C_NO_SPACE, MAYBE_CR (stderr));
+	    exit(1);
+	    }
+	}
     strncpy ((char *) keywordbuf, (char *) str, i);
     keywordbuf[i] = '\0';
     if (keywords->forceupper)
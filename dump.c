@@ -145,7 +145,7 @@ static void setdump (setp, mask)	/* Dump a set specification */
     firstnz = numnz = 0;
     for (cnum = SET_SIZE;  --cnum >= 0;  )
 	{
-	if (setp[cnum] & mask)
+	if (setp[condclassof (cnum)] & mask)
 	    {
 	    numnz++;
 	    firstnz = cnum;
@@ -177,13 +177,13 @@ static void subsetdump (setp, mask, dumpval) /* Dump part of a set spec */
     register int		cnum;	/* Next character's number */
     register int		rangestart; /* Value starting a range */
 
-    for (cnum = 0;  cnum < SET_SIZE;  setp++, cnum++)
+    for (cnum = 0;  cnum < SET_SIZE;  cnum++)
 	{
-	if (((*setp ^ dumpval) & mask) == 0)
+	if (((setp[condclassof (cnum)] ^ dumpval) & mask) == 0)
 	    {
-	    for (rangestart = cnum;  cnum < SET_SIZE;  setp++, cnum++)
+	    for (rangestart = cnum;  cnum < SET_SIZE;  cnum++)
 		{
-		if ((*setp ^ dumpval) & mask)
+		if ((setp[condclassof (cnum)] ^ dumpval) & mask)
 		    break;
 		}
 	    if (cnum == rangestart + 1)
@@ -31,6 +31,27 @@ static char Rcs_Id[] =
 #include "proto.h"
 #include "exp_table.h"
 
+/*
+ * Expansion strings are carved out of a chain of blocks, so that
+ * adding an expansion doesn't cost a malloc and emptying the table
+ * frees only a few blocks.  A block is normally EXP_ARENA_SIZE bytes,
+ * but is made bigger if a single string needs it.
+ */
+#define EXP_ARENA_SIZE	4096
+
+struct exp_arena
+    {
+    struct exp_arena *	next;		/* Next (older) block in chain */
+    unsigned int	used;		/* Bytes of text used so far */
+    unsigned int	size;		/* Bytes of text available */
+    char		text[1];	/* Start of the text (really longer) */
+    };
+
+static char *	arena_copy P ((struct exp_table * e, const char * s));
+static unsigned int
+		exp_hash P ((const char * s));
+static void	exp_reindex P ((struct exp_table * e, int new_size));
+
 void exp_table_init (e, orig_word)
     struct exp_table *
 			e;
@@ -42,6 +63,9 @@ void exp_table_init (e, orig_word)
     e->exps = malloc (e->max_size * sizeof (*e->exps));
     e->flags = malloc (e->max_size * sizeof (*e->flags) * MASKSIZE);
     e->orig_word = orig_word;
+    e->index = NULL;
+    e->index_size = 0;
+    e->arena = NULL;
     }
 
 const ichar_t * get_orig_word (e)
@@ -77,19 +101,106 @@ int num_expansions (e)
     return e->size;
     }
 
+/*
+ * Hash an expansion for the index.  This is the same multiplicative
+ * string hash used in many places; it only needs to spread the
+ * expansions of a single root.
+ */
+static unsigned int exp_hash (s)
+    const char *	s;
+    {
+    register unsigned int
+			h;
+
+    for (h = 0;  *s != '\0';  s++)
+	h = h * 31 + (unsigned char) *s;
+    return h;
+    }
+
+/*
+ * Rebuild the hash index with room for new_size entries.  The index
+ * is always kept less than half full, so probes stay short.
+ */
+static void exp_reindex (e, new_size)
+    struct exp_table *	e;
+    int			new_size;
+    {
+    int			i;
+    register unsigned int
+			slot;
+
+    if (e->index != NULL)
+	free (e->index);
+    e->index = malloc (new_size * sizeof (*e->index));
+    if (e->index == NULL)
+	{
+	(void) fprintf (stderr, TGOOD_C_NO_SPACE);
+	exit (1);
+	}
+    e->index_size = new_size;
+    for (i = 0;  i < new_size;  i++)
+	e->index[i] = -1;
+    for (i = 0;  i < e->size;  i++)
+	{
+	slot = exp_hash (e->exps[i]) & (new_size - 1);
+	while (e->index[slot] >= 0)
+	    slot = (slot + 1) & (new_size - 1);
+	e->index[slot] = i;
+	}
+    }
+
+/*
+ * Copy a string into the table's arena, starting a new block if the
+ * current one is too full.
+ */
+static char * arena_copy (e, s)
+    struct exp_table *	e;
+    const char *	s;
+    {
+    unsigned int	len;
+    unsigned int	size;
+    struct exp_arena *	block;
+    char *		copy;
+
+    len = strlen (s) + 1;
+    block = e->arena;
+    if (block == NULL  ||  block->used + len > block->size)
+	{
+	size = len > EXP_ARENA_SIZE ? len : EXP_ARENA_SIZE;
+	block = malloc (sizeof (struct exp_arena) + size);
+	if (block == NULL)
+	    {
+	    (void) fprintf (stderr, TGOOD_C_NO_SPACE);
+	    exit (1);
+	    }
+	block->next = e->arena;
+	block->used = 0;
+	block->size = size;
+	e->arena = block;
+	}
+    copy = &block->text[block->used];
+    BCOPY (s, copy, len);
+    block->used += len;
+    return copy;
+    }
+
 int add_expansion_copy (e, s, flags)
     struct exp_table *	e;
     const  char *	s;
     MASKTYPE		flags[];
     {
-    char *		copy;
-    int			copy_size;
+    register unsigned int
+			slot;
     int			i;
     
     /* 
      * Check not already there.
      */
-    for (i = 0; i < e->size; i++)
+    if (2 * (e->size + 1) > e->index_size)
+	exp_reindex (e, e->index_size == 0 ? 16 : 2 * e->index_size);
+    for (slot = exp_hash (s) & (e->index_size - 1);
+      (i = e->index[slot]) >= 0;
+      slot = (slot + 1) & (e->index_size - 1))
 	{
 	if (strcmp (e->exps[i], s) == 0)
 	    return 0;
@@ -100,7 +211,7 @@ int add_expansion_copy (e, s, flags)
      */
     if (e->size == e->max_size)
 	{
-	e->max_size *= 2;
+	e->max_size = e->max_size == 0 ? 1 : 2 * e->max_size;
 	e->exps = realloc(e->exps, e->max_size * sizeof (*e->exps));
 	e->flags =
 	  realloc(e->flags, e->max_size * sizeof (*e->flags) * MASKSIZE);
@@ -112,16 +223,8 @@ int add_expansion_copy (e, s, flags)
 	    }
 	}
 
-    copy_size = strlen (s) + 1;
-    copy = malloc (copy_size * sizeof copy[0]);
-    if (copy == NULL)
-	{
-	(void) fprintf (stderr, TGOOD_C_NO_SPACE);
-	exit (1);
-	}
-
-    strncpy (copy, s, copy_size);
-    e->exps[e->size] = copy;
+    e->exps[e->size] = arena_copy (e, s);
+    e->index[slot] = e->size;
     BCOPY ((char *) &flags[0], &e->flags[e->size * MASKSIZE],
       MASKSIZE * sizeof flags[0]);
     ++e->size;
@@ -131,11 +234,25 @@ int add_expansion_copy (e, s, flags)
 struct exp_table * exp_table_empty (e)
     struct exp_table *	e;
     {
-    int			i;
+    struct exp_arena *	block;
 
-    for (i = 0; i < e->size; i++)
-	free (e->exps[i]);
+    while ((block = e->arena) != NULL)
+	{
+	e->arena = block->next;
+	free (block);
+	}
+    if (e->index != NULL)
+	free (e->index);
+    e->index = NULL;
+    e->index_size = 0;
+    if (e->exps != NULL)
+	free (e->exps);
+    e->exps = NULL;
+    if (e->flags != NULL)
+	free (e->flags);
+    e->flags = NULL;
     e->size = 0;
+    e->max_size = 0;
     return e;
     }
 
@@ -55,6 +55,10 @@ struct exp_table
   int		size;		/* Current number of expansions */
   int		max_size;	/* Maximum number of expansions */
   ichar_t *	orig_word;	/* Root word that flags were applied to */
+  int *		index;		/* Hash of expansion numbers, -1 if unused */
+  int		index_size;	/* Size of index (a power of 2) */
+  struct exp_arena *
+		arena;		/* Blocks holding the expansion strings */
   };
 
 /*
@@ -87,6 +91,7 @@ extern int	add_expansion_copy (struct exp_table * e, const char * s,
 
 /*
  * Empty the table of expansions, freeing any resources allocated.
+ * The table can be reused afterwards without another exp_table_init.
  * Returns a pointer to the now empty struct.
  */
 extern struct exp_table * 
@@ -96,15 +96,70 @@ static char Rcs_Id[] =
 #include "config.h"
 #include "ispell.h"
 #include "proto.h"
+#include "msgs.h"
+
+/*
+ * Checking a word with good() and compoundgood() is expensive, and
+ * real documents use the same words over and over.  So in -a and -l
+ * modes checkline() remembers its verdicts on the last WORDCACHE words
+ * in a cache, which forgets the least recently used word first.  Each
+ * context has its own cache, made the first time it is needed.  The
+ * cache is emptied whenever wcgeneration changes, which treeinsert()
+ * arranges whenever a personal word is added.
+ */
+#define WCKEYLEN	24		/* Longest word that will be cached */
+
+struct wcentry
+    {
+    ichar_t		w_word[WCKEYLEN + 1]; /* Word, exactly as checked */
+    short		w_group;	/* String group it was checked under */
+    short		w_verdict;	/* Verdict on it, GOOD_xxx */
+    struct dent *	w_root;		/* Its root, if verdict is GOOD_ROOT */
+    int			w_next;		/* Next entry in hash chain, or -1 */
+    int			w_newer;	/* Next more recently used, or -1 */
+    int			w_older;	/* Next less recently used, or -1 */
+    };
+
+struct wordcache
+    {
+    struct wcentry *	wc_ents;	/* The entries (WORDCACHE of them) */
+    int *		wc_chains;	/* Heads of hash chains, or -1 */
+    int			wc_used;	/* Number of entries filled */
+    int			wc_newest;	/* Most recently used entry */
+    int			wc_oldest;	/* Least recently used entry */
+    unsigned int	wc_generation;	/* Wcgeneration when last emptied */
+    unsigned long	wc_hits;	/* Number of words found */
+    unsigned long	wc_misses;	/* Number of words not found */
+    unsigned long	wc_flushes;	/* Number of times emptied */
+    };
 
 int		good P ((ichar_t * word, int ignoreflagbits, int allhits,
 		  int pfxopts, int sfxopts));
+int		goodent P ((ichar_t * word, ichar_t * nword, int len,
+		  struct dent * dp, int ignoreflagbits, int allhits,
+		  int pfxopts, int sfxopts));
 int		cap_ok P ((ichar_t * word, struct success * hit, int len));
 static int	entryhasaffixes P ((struct dent * dent, struct success * hit));
+#ifndef LIBISPELL
 void		flagpr P ((ichar_t * word, int preflag, int prestrip,
 		  int preadd, int sufflag, int sufadd));
+#endif /* LIBISPELL */
+struct checkctx * newckctx P ((void));
+void		freeckctx P ((struct checkctx * ctx));
+struct checkctx * setckctx P ((struct checkctx * ctx));
+static struct wordcache *
+		getwcache P ((void));
+static void	wcflush P ((struct wordcache * wc));
+static int	wcfind P ((struct wordcache * wc, ichar_t * word,
+		  int * chainp));
+static void	wcunlink P ((struct wordcache * wc, int ent));
+static void	wcmakenewest P ((struct wordcache * wc, int ent));
+int		goodcachelookup P ((ichar_t * word, struct dent ** rootp));
+void		goodcacheenter P ((ichar_t * word, int verdict,
+		  struct dent * root));
+void		goodcachestats P ((FILE * statfile));
 
-static ichar_t *	orig_word;
+#define orig_word	(curctx->c_origword)	/* Word given to good() */
 
 int good (w, ignoreflagbits, allhits, pfxopts, sfxopts)
     ichar_t *		w;		/* Word to look up */
@@ -116,8 +171,6 @@ int good (w, ignoreflagbits, allhits, pfxopts, sfxopts)
     ichar_t		nword[INPUTWORDLEN + MAXAFFIXLEN];
     register ichar_t *	p;
     register ichar_t *	q;
-    register int	n;
-    register struct dent * dp;
 
     /*
     ** Make an uppercase copy of the word we are checking.
@@ -125,16 +178,39 @@ int good (w, ignoreflagbits, allhits, pfxopts, sfxopts)
     for (p = w, q = nword;  *p;  )
 	*q++ = mytoupper (*p++);
     *q = 0;
-    n = q - nword;
-
-    numhits = 0;
 
+#ifndef LIBISPELL
     if (cflag)
 	{
 	(void) printf ("%s", (char *) ichartosstr (w, 0));
 	orig_word = w;
+	return goodent (w, nword, q - nword, (struct dent *) NULL,
+	  ignoreflagbits, allhits, pfxopts, sfxopts);
 	}
-    else if ((dp = lookup (nword, 1)) != NULL)
+#endif /* LIBISPELL */
+    return goodent (w, nword, q - nword, lookup (nword, 1),
+      ignoreflagbits, allhits, pfxopts, sfxopts);
+    }
+
+/*
+** The rest of good(), for a word whose uppercase form has already been
+** looked up in the dictionary, perhaps as part of a batch (see
+** lookupbatch).  Dp is what lookup() returned for it.
+*/
+int goodent (w, nword, n, dp, ignoreflagbits, allhits, pfxopts, sfxopts)
+    ichar_t *		w;		/* Word to look up */
+    ichar_t *		nword;		/* Same word, in uppercase */
+    int			n;		/* Length of the word */
+    register struct dent * dp;		/* Dictionary entry for nword */
+    int			ignoreflagbits;	/* NZ to ignore affix flags in dict */
+    int			allhits;	/* NZ to ignore case, get every hit */
+    int			pfxopts;	/* Options to apply to prefixes */
+    int			sfxopts;	/* Options to apply to suffixes */
+    {
+
+    numhits = 0;
+
+    if (dp != NULL)
 	{
 	hits[0].dictent = dp;
 	hits[0].prefix = NULL;
@@ -158,8 +234,10 @@ int good (w, ignoreflagbits, allhits, pfxopts, sfxopts)
 
     chk_aff (w, nword, n, ignoreflagbits, allhits, pfxopts, sfxopts);
 
+#ifndef LIBISPELL
     if (cflag)
 	(void) putchar ('\n');
+#endif /* LIBISPELL */
 
     return numhits;
     }
@@ -308,6 +386,7 @@ static int entryhasaffixes (dent, hit)
     return 1;			/* Yes, these affixes are legal */
     }
 
+#ifndef LIBISPELL
 /*
  * Print a word and its flag, making sure the case of the output matches
  * the case of the original found in "orig_word".
@@ -426,3 +505,269 @@ void flagpr (word, preflag, prestrip, preadd, sufflag, sufadd)
     if (sufflag > 0)
 	(void) putchar (sufflag);
     }
+#endif /* LIBISPELL */
+
+/*
+ * Create a new checker context, in the same state as defctx was at
+ * startup.  Returns NULL if there's no memory.
+ */
+struct checkctx * newckctx ()
+    {
+    struct checkctx *	ctx;
+
+    ctx = (struct checkctx *) calloc (1, sizeof (struct checkctx));
+    if (ctx != NULL)
+	ctx->c_latexmode = 'P';
+    return ctx;
+    }
+
+/*
+ * Release a context made by newckctx.  It must not be the current one.
+ */
+void freeckctx (ctx)
+    struct checkctx *	ctx;		/* Context to release */
+    {
+
+    if (ctx->c_keywordbuf != NULL)
+	free ((char *) ctx->c_keywordbuf);
+    if (ctx->c_wcache != NULL)
+	{
+	free ((char *) ctx->c_wcache->wc_ents);
+	free ((char *) ctx->c_wcache->wc_chains);
+	free ((char *) ctx->c_wcache);
+	}
+    free ((char *) ctx);
+    }
+
+/*
+ * Make ctx the current checker context (of the calling thread, if
+ * THREADLOCAL is set up), so that good(), makepossibilities(), and the
+ * rest use and return their results in it.  A null ctx selects defctx.
+ * Returns the previous context, so that it can be restored.
+ */
+struct checkctx * setckctx (ctx)
+    struct checkctx *	ctx;		/* Context to switch to */
+    {
+    struct checkctx *	oldctx;
+
+    oldctx = curctx;
+    curctx = ctx == NULL ? &defctx : ctx;
+    return oldctx;
+    }
+
+/*
+ * Get the current context's word cache, making it if necessary and
+ * emptying it if the personal dictionary has changed since it was
+ * filled.  Returns NULL if the cache is turned off or there's no
+ * memory for it.
+ */
+static struct wordcache * getwcache ()
+    {
+    register struct wordcache *
+			wc;
+
+    if (WORDCACHE <= 0)
+	return NULL;
+    wc = curctx->c_wcache;
+    if (wc == NULL)
+	{
+	wc = (struct wordcache *) calloc (1, sizeof (struct wordcache));
+	if (wc == NULL)
+	    return NULL;
+	wc->wc_ents = (struct wcentry *)
+	  malloc (WORDCACHE * sizeof (struct wcentry));
+	wc->wc_chains = (int *) malloc (WORDCACHE * sizeof (int));
+	if (wc->wc_ents == NULL  ||  wc->wc_chains == NULL)
+	    {
+	    if (wc->wc_ents != NULL)
+		free ((char *) wc->wc_ents);
+	    if (wc->wc_chains != NULL)
+		free ((char *) wc->wc_chains);
+	    free ((char *) wc);
+	    return NULL;
+	    }
+	wcflush (wc);
+	wc->wc_flushes = 0;
+	curctx->c_wcache = wc;
+	}
+    else if (wc->wc_generation != wcgeneration)
+	wcflush (wc);
+    return wc;
+    }
+
+/* Empty a word cache */
+static void wcflush (wc)
+    register struct wordcache *
+			wc;		/* Cache to empty */
+    {
+    register int	i;
+
+    for (i = 0;  i < WORDCACHE;  i++)
+	wc->wc_chains[i] = -1;
+    wc->wc_used = 0;
+    wc->wc_newest = wc->wc_oldest = -1;
+    wc->wc_generation = wcgeneration;
+    wc->wc_flushes++;
+    }
+
+/*
+ * Find a word in a word cache, checked under the current string group.
+ * Returns the entry's index, or -1 if it isn't there.  In either case,
+ * *chainp gets the index of the hash chain the word belongs on.
+ */
+static int wcfind (wc, word, chainp)
+    register struct wordcache *
+			wc;		/* Cache to look in */
+    ichar_t *		word;		/* Word to look for */
+    int *		chainp;		/* Where to put chain index */
+    {
+    register int	ent;
+    register struct wcentry *
+			ep;
+
+    *chainp = hash (word, WORDCACHE);
+    for (ent = wc->wc_chains[*chainp];  ent >= 0;  ent = ep->w_next)
+	{
+	ep = &wc->wc_ents[ent];
+	if (ep->w_group == defstringgroup  &&  icharcmp (ep->w_word, word) == 0)
+	    return ent;
+	}
+    return -1;
+    }
+
+/* Take an entry off a word cache's use list */
+static void wcunlink (wc, ent)
+    register struct wordcache *
+			wc;		/* Cache holding entry */
+    int			ent;		/* Entry to take off the list */
+    {
+    register struct wcentry *
+			ep;
+
+    ep = &wc->wc_ents[ent];
+    if (ep->w_newer >= 0)
+	wc->wc_ents[ep->w_newer].w_older = ep->w_older;
+    else
+	wc->wc_newest = ep->w_older;
+    if (ep->w_older >= 0)
+	wc->wc_ents[ep->w_older].w_newer = ep->w_newer;
+    else
+	wc->wc_oldest = ep->w_newer;
+    }
+
+/* Put an entry at the most-recently-used end of the use list */
+static void wcmakenewest (wc, ent)
+    register struct wordcache *
+			wc;		/* Cache holding entry */
+    int			ent;		/* Entry just used */
+    {
+    register struct wcentry *
+			ep;
+
+    ep = &wc->wc_ents[ent];
+    ep->w_newer = -1;
+    ep->w_older = wc->wc_newest;
+    if (wc->wc_newest >= 0)
+	wc->wc_ents[wc->wc_newest].w_newer = ent;
+    else
+	wc->wc_oldest = ent;
+    wc->wc_newest = ent;
+    }
+
+/*
+ * Look up the verdict on a word in the current context's word cache.
+ * Returns GOOD_UNKNOWN if the word isn't there.  If the verdict is
+ * GOOD_ROOT, *rootp gets the dictionary entry of the word's root.
+ */
+int goodcachelookup (word, rootp)
+    ichar_t *		word;		/* Word, exactly as it will be checked */
+    struct dent **	rootp;		/* Where to put the root's entry */
+    {
+    register struct wordcache *
+			wc;
+    int			chain;
+    register int	ent;
+
+    if ((wc = getwcache ()) == NULL)
+	return GOOD_UNKNOWN;
+    if (icharlen (word) > WCKEYLEN
+      ||  (ent = wcfind (wc, word, &chain)) < 0)
+	{
+	wc->wc_misses++;
+	return GOOD_UNKNOWN;
+	}
+    wc->wc_hits++;
+    if (ent != wc->wc_newest)
+	{
+	wcunlink (wc, ent);
+	wcmakenewest (wc, ent);
+	}
+    *rootp = wc->wc_ents[ent].w_root;
+    return wc->wc_ents[ent].w_verdict;
+    }
+
+/*
+ * Remember the verdict on a word in the current context's word cache,
+ * forgetting the least recently used word if the cache is full.
+ */
+void goodcacheenter (word, verdict, root)
+    ichar_t *		word;		/* Word, exactly as it was checked */
+    int			verdict;	/* Verdict on it, GOOD_xxx */
+    struct dent *	root;		/* Its root, if verdict is GOOD_ROOT */
+    {
+    register struct wordcache *
+			wc;
+    int			chain;
+    register int	ent;
+    register struct wcentry *
+			ep;
+    register int *	linkp;
+
+    if ((wc = getwcache ()) == NULL  ||  icharlen (word) > WCKEYLEN
+      ||  wcfind (wc, word, &chain) >= 0)
+	return;
+    if (wc->wc_used < WORDCACHE)
+	ent = wc->wc_used++;
+    else
+	{
+	/*
+	** Reuse the least recently used entry, after taking it off its
+	** hash chain.
+	*/
+	ent = wc->wc_oldest;
+	wcunlink (wc, ent);
+	ep = &wc->wc_ents[ent];
+	for (linkp = &wc->wc_chains[hash (ep->w_word, WORDCACHE)];
+	  *linkp != ent;
+	  linkp = &wc->wc_ents[*linkp].w_next)
+	    ;
+	*linkp = ep->w_next;
+	}
+    ep = &wc->wc_ents[ent];
+    (void) icharcpy (ep->w_word, word);
+    ep->w_group = defstringgroup;
+    ep->w_verdict = verdict;
+    ep->w_root = root;
+    ep->w_next = wc->wc_chains[chain];
+    wc->wc_chains[chain] = ent;
+    wcmakenewest (wc, ent);
+    }
+
+/*
+ * Report how well the current context's word cache has done.
+ */
+void goodcachestats (statfile)
+    FILE *		statfile;	/* Where to write the report */
+    {
+    register struct wordcache *
+			wc;
+    unsigned long	lookups;
+
+    wc = curctx->c_wcache;
+    if (wc == NULL)
+	return;
+    lookups = wc->wc_hits + wc->wc_misses;
+    (void) fprintf (statfile, GOOD_C_CACHE_STATS (wc->wc_hits, lookups,
+      lookups == 0 ? 0.0 : 100.0 * wc->wc_hits / lookups,
+      wc->wc_used, WORDCACHE, wc->wc_flushes));
+    }
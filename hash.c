@@ -70,6 +70,27 @@ static char Rcs_Id[] =
 #include "proto.h"
 
 int		hash P ((ichar_t * word, int hashtblsize));
+unsigned int	hashfprint P ((ichar_t * word));
+void		mphkey P ((ichar_t * word, unsigned int * keyp,
+		  unsigned int * checkp));
+unsigned int	mphslot P ((unsigned int key, unsigned int disp,
+		  unsigned int nslots));
+void		bloomadd P ((unsigned int * filter, unsigned int nblocks,
+		  unsigned int key, unsigned int check));
+int		bloomtest P ((unsigned int * filter, unsigned int nblocks,
+		  unsigned int key, unsigned int check));
+void		packinit P ((void));
+void		packword P ((unsigned char * out, unsigned char * in));
+void		unpackword P ((unsigned char * out, unsigned char * in));
+static unsigned long mix32 P ((unsigned long h));
+
+/*
+ * Codes of the digrams in hashheader.digrams, grouped by first
+ * character:  those starting with c are digramcodes[digramstart[c]]
+ * up to digramcodes[digramstart[c + 1]].  Set up by packinit.
+ */
+static unsigned short	digramstart[SET_SIZE + 1];
+static unsigned char	digramcodes[SET_SIZE];
 
 /*
  * The following hash algorithm is due to Ian Dall, with slight modifications
@@ -106,3 +127,216 @@ int hash (s, hashtblsize)
 	}
     return (unsigned long) h % hashtblsize;
     }
+
+/*
+ * Compute a 16-bit fingerprint of a word, for the bucketed hash index.
+ * This uses a different algorithm (FNV-1a) from hash() so that words
+ * that land in the same bucket usually have different fingerprints.
+ * Zero is never returned, since it marks an empty slot in a bucket.
+ */
+unsigned int hashfprint (s)
+    register ichar_t *	s;
+    {
+    register unsigned long
+			h = 2166136261UL;
+
+    while (*s != 0)
+	{
+	h ^= HASHUPPER (*s++);
+	h = (h * 16777619UL) & 0xFFFFFFFFUL;
+	}
+    h = (h >> 16) ^ (h & 0xFFFF);
+    return h == 0 ? 1 : (unsigned int) h;
+    }
+
+/*
+ * Compute the key and check value of a word for the minimal perfect
+ * hash.  They come from two different hashes computed in one pass, so
+ * that two words have the same key and check value only if they agree
+ * in 64 bits.
+ */
+void mphkey (s, keyp, checkp)
+    register ichar_t *	s;		/* Word to hash */
+    unsigned int *	keyp;		/* Where to put key */
+    unsigned int *	checkp;		/* Where to put check value */
+    {
+    register unsigned long
+			h1 = 2166136261UL;
+    register unsigned long
+			h2 = 0;
+
+    while (*s != 0)
+	{
+	h1 ^= HASHUPPER (*s);
+	h1 = (h1 * 16777619UL) & 0xFFFFFFFFUL;
+	h2 = (h2 * 0x9E3779B1UL + HASHUPPER (*s++)) & 0xFFFFFFFFUL;
+	}
+    *keyp = (unsigned int) mix32 (h1);
+    *checkp = (unsigned int) mix32 (h2);
+    }
+
+/*
+ * Find the perfect-hash slot for a key, given the displacement of its
+ * group.
+ */
+unsigned int mphslot (key, disp, nslots)
+    unsigned int	key;		/* Key from mphkey */
+    unsigned int	disp;		/* Displacement of key's group */
+    unsigned int	nslots;		/* Number of slots in table */
+    {
+
+    return (unsigned int) (mix32 ((unsigned long) key ^ disp) % nslots);
+    }
+
+/*
+ * Add a word, given its key and check value from mphkey, to a
+ * negative-lookup filter.  The key selects the block, and the bits
+ * within it are chosen by double hashing.
+ */
+void bloomadd (filter, nblocks, key, check)
+    unsigned int *	filter;		/* Filter to add to */
+    unsigned int	nblocks;	/* Number of blocks in filter */
+    unsigned int	key;		/* Key from mphkey */
+    unsigned int	check;		/* Check value from mphkey */
+    {
+    register unsigned int *
+			block;		/* Block the word's bits are in */
+    register unsigned int
+			bit;		/* Next bit to set */
+    register unsigned int
+			step;		/* Distance between bits */
+    register int	i;
+
+    block = &filter[(key % nblocks) * BLOOMBLOCKWORDS];
+    step = (key >> 16) | 1;
+    for (i = BLOOMHASHES, bit = check;  --i >= 0;  bit += step)
+	block[(bit >> 5) % BLOOMBLOCKWORDS] |= 1U << (bit & 31);
+    }
+
+/*
+ * See if a word might be in a negative-lookup filter.  Returns zero if
+ * the word definitely wasn't added to the filter.
+ */
+int bloomtest (filter, nblocks, key, check)
+    unsigned int *	filter;		/* Filter to test */
+    unsigned int	nblocks;	/* Number of blocks in filter */
+    unsigned int	key;		/* Key from mphkey */
+    unsigned int	check;		/* Check value from mphkey */
+    {
+    register unsigned int *
+			block;		/* Block the word's bits are in */
+    register unsigned int
+			bit;		/* Next bit to test */
+    register unsigned int
+			step;		/* Distance between bits */
+    register int	i;
+
+    block = &filter[(key % nblocks) * BLOOMBLOCKWORDS];
+    step = (key >> 16) | 1;
+    for (i = BLOOMHASHES, bit = check;  --i >= 0;  bit += step)
+	{
+	if ((block[(bit >> 5) % BLOOMBLOCKWORDS] & (1U << (bit & 31))) == 0)
+	    return 0;
+	}
+    return 1;
+    }
+
+/*
+ * Set up for packword from the digram codes in hashheader.digrams.
+ * This must be done again whenever the codes change.
+ */
+void packinit ()
+    {
+    register int	c;
+    register int	code;
+
+    for (c = 0;  c <= SET_SIZE;  c++)
+	digramstart[c] = 0;
+    for (code = 1;  code < SET_SIZE;  code++)
+	{
+	if (hashheader.digrams[code][0] != 0)
+	    digramstart[hashheader.digrams[code][0] + 1]++;
+	}
+    for (c = 0;  c < SET_SIZE;  c++)
+	digramstart[c + 1] += digramstart[c];
+    for (code = 1;  code < SET_SIZE;  code++)
+	{
+	if (hashheader.digrams[code][0] != 0)
+	    digramcodes[digramstart[hashheader.digrams[code][0]]++] = code;
+	}
+    for (c = SET_SIZE;  c > 0;  c--)
+	digramstart[c] = digramstart[c - 1];
+    digramstart[0] = 0;
+    }
+
+/*
+ * Convert a word to the packed form used by hash files built with
+ * "buildhash -z", in which each of the commonest digrams is replaced by
+ * one of the byte codes in hashheader.digrams.  Digrams are replaced
+ * from the left, so a word has only one packed form and can be compared
+ * with the hash file's words without unpacking them.  The packed word
+ * is never longer, so out may be the same as in.
+ */
+void packword (out, in)
+    register unsigned char *
+			out;		/* Where to put packed word */
+    register unsigned char *
+			in;		/* Word to pack */
+    {
+    register int	i;
+
+    while (*in != '\0')
+	{
+	for (i = digramstart[*in];  i < digramstart[*in + 1];  i++)
+	    {
+	    if (hashheader.digrams[digramcodes[i]][1] == in[1])
+		break;
+	    }
+	if (in[1] != '\0'  &&  i < digramstart[*in + 1])
+	    {
+	    *out++ = digramcodes[i];
+	    in += 2;
+	    }
+	else
+	    *out++ = *in++;
+	}
+    *out = '\0';
+    }
+
+/*
+ * Convert a word from the hash file's packed form back to a string.
+ */
+void unpackword (out, in)
+    register unsigned char *
+			out;		/* Where to put the word */
+    register unsigned char *
+			in;		/* Packed word */
+    {
+
+    for (  ;  *in != '\0';  in++)
+	{
+	if (hashheader.digrams[*in][0] != 0)
+	    {
+	    *out++ = hashheader.digrams[*in][0];
+	    *out++ = hashheader.digrams[*in][1];
+	    }
+	else
+	    *out++ = *in;
+	}
+    *out = '\0';
+    }
+
+/*
+ * Scramble the bits of a 32-bit value (the finalizer from MurmurHash3).
+ */
+static unsigned long mix32 (h)
+    register unsigned long h;
+    {
+
+    h ^= h >> 16;
+    h = (h * 0x85EBCA6BUL) & 0xFFFFFFFFUL;
+    h ^= h >> 13;
+    h = (h * 0xC2B2AE35UL) & 0xFFFFFFFFUL;
+    h ^= h >> 16;
+    return h;
+    }
@@ -291,6 +291,7 @@ int main (argc, argv)
     Cmd = *argv;
 
     Trynum = 0;
+    defctx.c_latexmode = 'P';
 
     p = getenv (LIBRARYVAR);
     if (p == NULL)
@@ -375,7 +376,7 @@ int main (argc, argv)
 	 * Used:
 	 *
 	 *	ABCDEFGHIJKLMNOPQRSTUVWXYZ 0123456789
-	 *	^^^^ ^ ^   ^^^ ^  ^^ ^^
+	 *	^^^^^^^^   ^^^ ^  ^^ ^^  ^
 	 *	abcdefghijklmnopqrstuvwxyz
 	 *	^^^^^^  ^   ^^^ ^ ^^^ ^^^
 	 */
@@ -505,7 +506,6 @@ int main (argc, argv)
 		    (void) printf ("\tMAXNAMLEN = %d\n", MAXNAMLEN);
 		    (void) printf ("\tMAXPATHLEN = %d\n", MAXPATHLEN);
 		    (void) printf ("\tMAXPCT = %d\n", MAXPCT);
-		    (void) printf ("\tMAXSEARCH = %d\n", MAXSEARCH);
 		    (void) printf ("\tMAXSTRINGCHARLEN = %d\n",
 		      MAXSTRINGCHARLEN);
 		    (void) printf ("\tMAXSTRINGCHARS = %d\n", MAXSTRINGCHARS);
@@ -558,6 +558,7 @@ int main (argc, argv)
 		    (void) printf ("\tPDICTHOME = (undefined)\n");
 #endif /* PDICTHOME */
 		    (void) printf ("\tPDICTVAR = \"%s\"\n", PDICTVAR);
+		    (void) printf ("\tPICFLAGS = \"%s\"\n", PICFLAGS);
 #ifdef PIECEMEAL_HASH_WRITES
 		    (void) printf ("\tPIECEMEAL_HASH_WRITES\n");
 #else /* PIECEMEAL_HASH_WRITES */
@@ -571,6 +572,7 @@ int main (argc, argv)
 #endif /* REGEX_LOOKUP */
 		    (void) printf ("\tREGLIB = \"%s\"\n", REGLIB);
 		    (void) printf ("\tR_OK = %d\n", R_OK);
+		    (void) printf ("\tSHLIBFLAGS = \"%s\"\n", SHLIBFLAGS);
 		    (void) printf ("\tSIGNAL_TYPE = \"%s\"\n",
 		      SIGNAL_TYPE_STRING);
 		    (void) printf ("\tSORTPERSONAL = %d\n", SORTPERSONAL);
@@ -600,6 +602,7 @@ int main (argc, argv)
 #else /* USESH */
 		    (void) printf ("\t!USESH\n");
 #endif /* USESH */
+		    (void) printf ("\tWORDCACHE = %d\n", WORDCACHE);
 		    (void) printf ("\tWORDS = \"%s\"\n", WORDS);
 		    (void) printf ("\tW_OK = %d\n", W_OK);
 		    (void) printf ("\tYACC = \"%s\"\n", YACC);
@@ -782,6 +785,38 @@ int main (argc, argv)
 		    usage ();
 		tryhardflag = 1;
 		break;
+	    case 'E':		/* -E:  look two edits away */
+		if (arglen > 2)
+		    usage ();
+		farflag = 1;
+		break;
+	    case 'G':		/* -G:  limit checks per word */
+		p = argv[argno] + 2;
+		if (*p == '\0')
+		    {
+		    argno++;
+		    if (argno >= argc)
+			usage ();
+		    p = argv[argno];
+		    }
+		/*
+		 * The budget must be a plain nonnegative number;  a typo
+		 * would otherwise quietly turn into "no limit".
+		 */
+		if (*p == '\0'  ||  p[strspn (p, "0123456789")] != '\0')
+		    usage ();
+		suggestbudget = atol (p);
+		break;
+	    case 'q':		/* -q:  near misses only on request */
+		if (arglen > 2)
+		    usage ();
+		lazyposs = 1;
+		break;
+	    case 'Z':		/* -Z:  report word-cache statistics */
+		if (arglen > 2)
+		    usage ();
+		wcstatsflag = 1;
+		break;
 	    case 'N':		/* -N:  suppress minimenu */
 		if (arglen > 2)
 		    usage ();
@@ -940,6 +975,7 @@ int main (argc, argv)
 	    case 'F':			/* Set external deformatting program */
 	    case 'L':			/* Bottom-of-screen context */
 	    case 'T':			/* Set preferred file type */
+	    case 'G':			/* Limit checks per word */
 	    case 'W':			/* Specify minimum word length */
 	    case 'd':			/* Specify dictionary */
 	    case 'f':			/* Write results to file */
@@ -1012,6 +1048,12 @@ int main (argc, argv)
 	{
 	askmode ();
 	treeoutput ();
+	if (wcstatsflag)
+	    {
+	    goodcachestats (stderr);
+	    if (suggestbudget > 0)
+		(void) fprintf (stderr, ISPELL_C_BUDGET_STATS (nposstruncated));
+	    }
 	exit (0);
 	}
     else if (eflag)
@@ -1033,6 +1075,11 @@ int main (argc, argv)
 	infile = setupdefmt(NULL, NULL);
 	outfile = stdout;
 	checkfile ();
+	if (wcstatsflag)
+	    {
+	    (void) fflush (stdout);
+	    goodcachestats (stderr);
+	    }
 	exit (0);
 	}
 
@@ -156,6 +156,18 @@
 #define const
 #endif /* __STDC__ */
 
+/*
+ * Diagnostics from code that libispell shares with the programs are
+ * written with DIAG ((stderr, format, ...)).  The library reports its
+ * failures through its return values and never writes on its caller's
+ * stderr, so there they are dropped.
+ */
+#ifdef LIBISPELL
+#define DIAG(args)	((void) 0)
+#else /* LIBISPELL */
+#define DIAG(args)	((void) fprintf args)
+#endif /* LIBISPELL */
+
 #define SET_SIZE	256
 
 #define MASKSIZE	(MASKBITS / MASKTYPE_WIDTH)
@@ -243,6 +255,7 @@ struct dent
     {
     struct dent *	next;
     unsigned char *	word;
+    unsigned short	fprint;		/* Fingerprint of word (hashfprint) */
     MASKTYPE		mask[MASKSIZE];
 #ifdef FULLMASKSET
     char		flags;
@@ -330,18 +343,179 @@ struct dent
 #define captype(x)	((x) & CAPTYPEMASK)
 
 /*
- * Language tables used to encode prefix and suffix information.
+** Dictionary entry as stored in the hash file.  The hash file is mapped
+** into memory and used in place, so it can't contain pointers.  Instead,
+** "next" is the index of the next entry in the table (NOENTRY if none)
+** and "word" is the offset of the word in the string table (NOWORD if
+** none).  A dictionary has only a few hundred distinct combinations of
+** affix flags and capitalization, so rather than carrying a full mask
+** each entry gives the number of its mask (with the flag bits exactly
+** as in struct dent) in the hash file's table of masks; use hentmask to
+** find it.  This keeps an entry to three 32-bit words.
+**
+** If the hash file was built with "buildhash -z", packedwords is set in
+** the header and the words are packed:  common digrams are replaced by
+** the byte codes in the header's digrams table (see packword), and a
+** word that ends another shares its storage.  Such words must be
+** unpacked before use, and may never be changed in place.
+**
+** The table proper holds one entry per word:  a standalone entry or a
+** variant header.  Capitalization variants are stored out of line,
+** after the last of these, so a search of a collision chain never has
+** to step over them.  A header's "next" is the index of its first
+** variant, and the last variant's "next" continues the chain.
+**
+** The rest of ispell works with struct dent.  Lookup() converts a hash
+** file entry (and its variants) into a struct dent the first time the
+** entry is found, records it in "hashdentp", and returns that copy
+** thereafter.
+*/
+struct hashdent
+    {
+    unsigned int	next;
+    unsigned int	word;
+    unsigned short	fprint;
+    unsigned short	maskno;			/* Index in hashmasks */
+    };
+
+struct hashmask
+    {
+    MASKTYPE		mask[MASKSIZE];
+#ifdef FULLMASKSET
+    char		flags;
+#endif
+    };
+
+#define MAXHASHMASKS	0x10000		/* Masks a maskno can select */
+#define hentmask(hdp)	(&hashmasks[(hdp)->maskno])
+
+#define NOENTRY		((unsigned int) -1)	/* Null "next" in hashdent */
+#define NOWORD		((unsigned int) -1)	/* Null "word" in hashdent */
+
+/*
+ * Optional bucketed index to the hash table (buildhash -b).  Each
+ * bucket fills one 64-byte cache line, and holds the fingerprints and
+ * hashents indexes of up to BUCKETSLOTS words, filled from the front.
+ * A word is looked for in the bucket chosen by hash() and, if that
+ * bucket is full, in the ones following it.  Since most words are
+ * found in their first bucket, and an empty slot ends the search, a
+ * lookup nearly always touches a single line of the index, and the
+ * entry and its string only when the fingerprints match.
+ */
+#define BUCKETSLOTS	10		/* No. of words in a hash bucket */
+
+struct hashbucket
+    {
+    unsigned short	fprint[BUCKETSLOTS];	/* Word fingerprints, 0=empty */
+    unsigned int	ent[BUCKETSLOTS];	/* Index in hashents of word */
+    unsigned int	unused;			/* Pad to a full cache line */
+    };
+
+/*
+ * Optional minimal perfect hash of the words in the hash table
+ * (buildhash -p).  mphkey() turns a word into a key and a check value;
+ * the check value selects a displacement, and mphslot() combines the
+ * key and displacement into the one slot the word can occupy.  The
+ * slot's check value rejects nearly all words that aren't in the
+ * dictionary without touching the entry; only a match is confirmed by
+ * comparing the strings.
+ */
+struct mphent
+    {
+    unsigned int	ent;			/* Index in hashents of word */
+    unsigned int	check;			/* Check value of word */
+    };
+
+/*
+ * Optional full-form table (buildhash -f):  every word that the affix
+ * rules derive from a root in the dictionary, with the ways it can be
+ * derived.  The words are in an open-addressed table, searched from
+ * the slot chosen by hash() up to the first empty one.  A word's hits
+ * give the hashents index of the root and the prefix and suffix
+ * entries applied, in the order chk_aff would find them, so the table
+ * can answer for chk_aff without stripping any affixes.  The words
+ * themselves follow the hits, as uppercase strings.
+ */
+struct fullform
+    {
+    unsigned int	word;			/* Offset of word, or NOWORD */
+    unsigned int	firsthit;		/* Index of its first hit */
+    unsigned short	fprint;			/* Fingerprint of word */
+    unsigned short	nhits;			/* Number of hits */
+    };
+
+struct fullhit
+    {
+    unsigned int	ent;			/* Index in hashents of root */
+    unsigned short	prefix;			/* Index in pflaglist */
+    unsigned short	suffix;			/* Index in sflaglist */
+    };
+
+#define NOAFFIX		((unsigned short) -1)	/* No affix in a fullhit */
+
+/*
+ * Optional near-miss index (buildhash -n):  every word the dictionary
+ * accepts, roots and derived words alike, filed under the word itself
+ * and under each string made by deleting one of its characters.  Two
+ * words one edit apart share at least one such key, so the words near
+ * a misspelling can be found by looking up its own keys (the
+ * "symmetric delete" method).  The entries for all keys that hash() to
+ * the same slot are kept together:  nearslots[i] is the index of the
+ * first entry for slot i, and nearslots[nnearslots] is the number of
+ * entries.  Each entry gives the key's fingerprint and the offset of
+ * the word, and the words themselves follow the entries, as uppercase
+ * strings.
+ */
+struct nearent
+    {
+    unsigned int	word;			/* Offset of word */
+    unsigned int	fprint;			/* Fingerprint of key */
+    };
+
+/*
+ * Optional trie (buildhash -t) of every word the dictionary accepts,
+ * in uppercase.  Node 0 is the root, and each other node is reached
+ * from its parent by the character ch.  The children of a node are
+ * kept together, starting at index kids.  A word ends at a node whose
+ * first child is a leaf with ch 0.
+ */
+struct trienode
+    {
+    unsigned int	kids;			/* Index of first child */
+    ichar_t		ch;			/* Character leading here */
+    unsigned short	nkids;			/* Number of children */
+    };
+
+/*
+ * Negative-lookup filter over the words in a dictionary:  a blocked
+ * Bloom filter.  Each word sets BLOOMHASHES bits, all in the one block
+ * (a 64-byte cache line) selected by its mphkey() key, so testing a
+ * word touches a single line.  If any of its bits is clear, the word
+ * is certainly not in the dictionary.  The main dictionary's filter is
+ * built by buildhash; the personal dictionary keeps its own.
+ */
+#define BLOOMBLOCKWORDS	16		/* 32-bit words per filter block */
+#define BLOOMHASHES	6		/* Bits set for each word */
+#define BLOOMBITS	12		/* Filter bits per word stored */
+
+/*
+ * Language tables used to encode prefix and suffix information.  The
+ * strip and affix strings are kept in the entry itself, so that the
+ * tables can be used directly from the hash file.  The conditions are
+ * stored per character class rather than per character:  characters
+ * that no condition in the language tells apart share a class (see
+ * condclass in the hash header), so that conds is small and dense.
  */
 struct flagent
     {
-    ichar_t *		strip;			/* String to strip off */
-    ichar_t *		affix;			/* Affix to append */
     short		flagbit;		/* Flag bit this ent matches */
     short		stripl;			/* Length of strip */
     short		affl;			/* Length of affix */
     short		numconds;		/* Number of char conditions */
     short		flagflags;		/* Modifiers on this flag */
-    char		conds[SET_SIZE + MAXSTRINGCHARS]; /* Adj. char conds */
+    ichar_t		affix[MAXAFFIXLEN + 1];	/* Affix to append */
+    ichar_t		strip[MAXAFFIXLEN + 1];	/* String to strip off */
+    char		conds[MAXCONDCLASSES];	/* Adj. char conds */
     };
 
 /*
@@ -350,16 +524,28 @@ struct flagent
 #define FF_CROSSPRODUCT	(1 << 0)		/* Affix does cross-products */
 #define FF_COMPOUNDONLY	(1 << 1)		/* Afx works in compounds */
 
-union ptr_union					/* Aid for building flg ptrs */
-    {
-    struct flagptr *	fp;			/* Pointer to more indexing */
-    struct flagent *	ent;			/* First of a list of ents */
-    };
-
-struct flagptr
+/*
+** The affix flag index, a trie over the characters of the affixes.
+** Suffixes are indexed on their characters from last to first and
+** prefixes from first to last, so that a single scan from the end (or
+** start) of a word visits, shortest first, every flag entry whose affix
+** matches it.  Each node gives the run of flag entries whose affix is
+** exactly the path to the node (the flag lists are sorted, so identical
+** affixes are together) and the node's children, which are stored
+** consecutively in order of the character leading to them.  The node
+** for the empty affix, the root, is always at position 0.  The trie is
+** built by buildhash and stored in the hash file, so references are
+** positions rather than pointers:  "firstent" is the index of the first
+** entry in sflaglist or pflaglist, and "firstchild" is the index, in the
+** same trie, of the first child.
+*/
+struct affixnode
     {
-    union ptr_union	pu;			/* Ent list or more indexes */
-    int			numents;		/* If zero, pu.fp is valid */
+    unsigned int	firstchild;		/* Index of first child */
+    unsigned int	firstent;		/* Index of first flag entry */
+    unsigned int	numents;		/* No. entries matching here */
+    unsigned short	nchildren;		/* No. of children */
+    ichar_t		ch;			/* Character leading here */
     };
 
 /*
@@ -380,7 +566,21 @@ struct strchartype
 #define SQUEEZE_STRINGS (1 << 1)		/* Count strchar as 1 byte */
 
 /*
- * Header placed at the beginning of the hash file.
+ * Header placed at the beginning of the hash file.  The file is laid
+ * out so that it can be mapped into memory and used without
+ * modification:  the header is followed by the string table, the hash
+ * table and its variants (an array of struct hashdent), the table of
+ * masks (an array of struct hashmask), the suffix and prefix tables
+ * (arrays of struct flagent), and the suffix and prefix flag indexes
+ * (arrays of struct affixnode), and optionally a bucketed index to the
+ * hash table (an array of struct hashbucket) and a perfect hash (the
+ * displacements followed by an array of struct mphent), the
+ * negative-lookup filter, and optionally a full-form table (an array of
+ * struct fullform, then one of struct fullhit, then the strings) and a
+ * near-miss index (the slot starts, then an array of struct nearent,
+ * then the strings) and a trie (an array of struct trienode), each
+ * starting at the offset recorded here and aligned suitably for its
+ * contents.
  */
 struct hashheader
     {
@@ -393,17 +593,43 @@ struct hashheader
     unsigned int stringsize;			/* Size of string table */
     unsigned int lstringsize;			/* Size of lang. str tbl */
     unsigned int tblsize;			/* No. entries in hash tbl */
+    unsigned int nvariants;			/* No. variants after tbl */
+    unsigned int nmasks;			/* No. entries in mask tbl */
     unsigned int stblsize;			/* No. entries in sfx tbl */
     unsigned int ptblsize;			/* No. entries in pfx tbl */
     unsigned int sortval;			/* Largest sort ID assigned */
     unsigned int nstrchars;			/* No. strchars defined */
     unsigned int nstrchartype;			/* No. strchar types */
+    unsigned int ncondclasses;			/* No. affix cond classes */
     unsigned int strtypestart;			/* Start of strtype table */
+    unsigned int stringstart;			/* File offset of strings */
+    unsigned int tblstart;			/* File offset of hash tbl */
+    unsigned int maskstart;			/* File offset of mask tbl */
+    unsigned int flagstart;			/* File offset of flag tbls */
+    unsigned int sindexstart;			/* File offset of sfx index */
+    unsigned int pindexstart;			/* File offset of pfx index */
+    unsigned int bucketstart;			/* File offset of buckets */
+    unsigned int nbuckets;			/* No. buckets, 0 if none */
+    unsigned int mphstart;			/* File offset of perf. hash */
+    unsigned int nmphdisps;			/* No. displacements, 0=none */
+    unsigned int nmphslots;			/* No. slots in perf. hash */
+    unsigned int bloomstart;			/* File offset of filter */
+    unsigned int nbloomblocks;			/* No. filter blocks, 0=none */
+    unsigned int fullstart;			/* File offset of full forms */
+    unsigned int nfullslots;			/* No. full-form slots, 0=none */
+    unsigned int nfullhits;			/* No. full-form hits */
+    unsigned int nearstart;			/* File offset of near index */
+    unsigned int nnearslots;			/* No. near-miss slots, 0=none */
+    unsigned int nnearents;			/* No. near-miss entries */
+    unsigned int triestart;			/* File offset of trie */
+    unsigned int ntrienodes;			/* No. trie nodes, 0=none */
+    unsigned int filesize;			/* Total size of hash file */
     char nrchars[5];				/* Nroff special characters */
     char texchars[13];				/* TeX special characters */
     char compoundflag;				/* Compund-word handling */
     char defhardflag;				/* Default tryveryhard flag */
     char flagmarker;				/* "Start-of-flags" char */
+    char packedwords;				/* NZ if words packed (-z) */
     unsigned short sortorder[SET_SIZE + MAXSTRINGCHARS]; /* Sort ordering */
     ichar_t lowerconv[SET_SIZE + MAXSTRINGCHARS]; /* Lower-conversion table */
     ichar_t upperconv[SET_SIZE + MAXSTRINGCHARS]; /* Upper-conversion table */
@@ -411,6 +637,8 @@ struct hashheader
     char upperchars[SET_SIZE + MAXSTRINGCHARS]; /* NZ for uppercase chars */
     char lowerchars[SET_SIZE + MAXSTRINGCHARS]; /* NZ for lowercase chars */
     char boundarychars[SET_SIZE + MAXSTRINGCHARS]; /* NZ for boundary chars */
+    unsigned char condclass[SET_SIZE + MAXSTRINGCHARS]; /* Class in conds */
+    unsigned char digrams[SET_SIZE][2];		/* Digram packed as each code */
     char stringstarts[SET_SIZE];		/* NZ if char can start str */
     unsigned char stringchars[MAXSTRINGCHARS][MAXSTRINGCHARLEN + 1];
 						/* String chars */
@@ -420,7 +648,7 @@ struct hashheader
     };
 
 /* hash table magic number */
-#define MAGIC			0x9602
+#define MAGIC			0x960F
 
 /* compile options, put in the hash header for consistency checking */
 # define MAGICNOTUSED1		0x01		/* No longer used */
@@ -452,6 +680,17 @@ struct success
     struct flagent *	suffix;		/* Suffix flag used, or NULL */
     };
 
+/*
+ * Verdicts on a word, as -a and -l decide them and as the word cache
+ * (see goodcachelookup) remembers them.  The values match the
+ * ISPELL_xxx results in libispell.h.
+ */
+#define GOOD_UNKNOWN	(-1)		/* Not known (not in the cache) */
+#define GOOD_MISS	0		/* Misspelled */
+#define GOOD_OK		1		/* In the dictionary as given */
+#define GOOD_ROOT	2		/* A root plus affixes */
+#define GOOD_COMPOUND	3		/* A legal compound */
+
 /*
  * Structure used to describe keyword-lookup tables.  The lookup
  * routine uses binary search on the keyword array.  Maxlen and minlen
@@ -536,6 +775,7 @@ extern ichar_t	mytoupper P ((unsigned int ch));
 			  &&  isspace((unsigned char) (X)))
 #define iswordch(X)	(hashheader.wordchars[(X)])
 #define isboundarych(X) (hashheader.boundarychars[(X)])
+#define condclassof(X)	(hashheader.condclass[(X)])
 #define isstringstart(X) (hashheader.stringstarts[(unsigned char) (X)])
 #define mytolower(X)	(hashheader.lowerconv[(X)])
 #define mytoupper(X)	(hashheader.upperconv[(X)])
@@ -547,8 +787,8 @@ extern ichar_t	mytoupper P ((unsigned int ch));
 ** not a character.
 **
 ** The "l_" versions set "len" to the length of the string character as a
-** handy side effect.  (Note that the global "laststringch" is also set,
-** and sometimes used, by these macros.)
+** handy side effect.  (Note that "laststringch", in the checker context,
+** is also set, and sometimes used, by these macros.)
 **
 ** The "l1_" versions go one step further and guarantee that the "len"
 ** field is valid for *all* characters, being set to 1 even if the macro
@@ -576,6 +816,71 @@ extern ichar_t	mytoupper P ((unsigned int ch));
 #define STRTOSICHAR_SIZE ((INPUTWORDLEN + 4 * MAXAFFIXLEN + 4) \
 			  * sizeof (ichar_t))
 
+#define MAXPOSSIBLE	100	/* Max no. of possibilities to generate */
+#define MAXROOTMEMO	16	/* Max no. of roots chk_aff remembers */
+
+/*
+ * A candidate root that chk_aff has looked up, and what it found.
+ */
+struct rootmemo
+    {
+    int			r_len;		/* icharlen (r_word) */
+    struct dent *	r_dent;		/* What lookup() returned for it */
+    ichar_t		r_word[INPUTWORDLEN + MAXAFFIXLEN]; /* The root */
+    };
+
+/*
+ * Checker context:  the state of one spelling check.  Everything that
+ * good(), makepossibilities(), the deformatter, and the routines they
+ * call keep between calls or hand back to their callers lives here,
+ * rather than in globals or static buffers, so that several checks can
+ * be under way at once (e.g., one per thread) against a single copy of
+ * the dictionary.  The routines use the context curctx points to;  the
+ * old global names (hits, pcount, math_mode, etc.) are defined below to
+ * stand for its fields, so existing code works unchanged.  Ispell
+ * itself uses only defctx.  Every field starts out zero except the
+ * LaTeX mode, which must be 'P';  newckctx sets it in the contexts it
+ * makes, and the startup code (main, ispell_init) sets it in defctx.
+ */
+struct checkctx
+    {
+    char		c_latexmode;	/* LaTeX parsing mode (LaTeX_Mode) */
+    int			c_mathmode;	/* Odd if in TeX math (math_mode) */
+    int			c_insidehtml;	/* HTML state (insidehtml) */
+    int			c_texcomment;	/* NZ if in a TeX comment */
+    int			c_wordadjust;	/* Stringchar difference in word len */
+    int			c_savemathmode;	/* Math mode outside TeX comment */
+    char		c_savelatexmode; /* LaTeX mode outside TeX comment */
+    unsigned int	c_mathdollars;	/* Double-dollar math nesting bits */
+    unsigned char *	c_keywordbuf;	/* Scratch buffer for keywords */
+    unsigned int	c_keywordbufsize; /* Size of c_keywordbuf */
+    int			c_numhits;	/* Number of hits in dict lookups */
+    struct success	c_hits[MAX_HITS]; /* Table of hits gotten in lookup */
+    ichar_t *		c_origword;	/* Word being checked by good() */
+    char		c_possibilities[MAXPOSSIBLE][INPUTWORDLEN + MAXAFFIXLEN];
+					/* Table of possible corrections */
+    int			c_pcount;	/* Count of possibilities generated */
+    int			c_maxposslen;	/* Length of longest possibility */
+    int			c_easypossibilities;
+					/* Number of "easy" corrections found */
+    long		c_budget;	/* Most checks per list, 0=no limit */
+    long		c_budgetleft;	/* Checks left for list, -1=no limit */
+    int			c_truncated;	/* NZ if list was cut short */
+    long		c_ntruncated;	/* Number of lists cut short */
+    int			c_farmisses;	/* NZ to look two edits away */
+    int			c_nomem;	/* NZ if libispell ran out of memory */
+    unsigned int	c_laststringch;	/* Last string character matched */
+    ichar_t		c_sichar[STRTOSICHAR_SIZE / sizeof (ichar_t)];
+					/* Result of strtosichar */
+    unsigned char	c_sstr[ICHARTOSSTR_SIZE]; /* Result of ichartosstr */
+    char		c_printichar[MAXSTRINGCHARLEN + 1];
+					/* Result of printichar */
+    struct wordcache *	c_wcache;	/* Cache of verdicts, or NULL */
+    int			c_nroots;	/* Number of roots in c_roots */
+    struct rootmemo	c_roots[MAXROOTMEMO];
+					/* Roots looked up by this chk_aff */
+    };
+
 /*
  * termcap variables
  */
@@ -613,16 +918,43 @@ EXTERN char	termcap[2048];	/* termcap entry */
 EXTERN char	termstr[2048];	/* for string values */
 EXTERN char *	termptr;	/* pointer into termcap, used by tgetstr */
 
-EXTERN int	numhits;	/* number of hits in dictionary lookups */
-EXTERN struct success
-		hits[MAX_HITS]; /* table of hits gotten in lookup */
+#define numhits		(curctx->c_numhits) /* number of hits in lookups */
+#define hits		(curctx->c_hits) /* table of hits gotten in lookup */
 
 EXTERN unsigned char *
 		hashstrings;	/* Strings in hash table */
 EXTERN struct hashheader
 		hashheader;	/* Header of hash table */
+EXTERN struct hashdent *
+		hashents;	/* Main hash table, as found in hash file */
+EXTERN struct hashmask *
+		hashmasks;	/* Masks used by hashents */
+EXTERN struct dent **
+		hashdentp;	/* Usable versions of hashents, if loaded */
 EXTERN struct dent *
-		hashtbl;	/* Main hash table, for dictionary */
+		hashtbl;	/* Table being built (buildhash, icombine) */
+EXTERN struct hashbucket *
+		hashbuckets;	/* Bucketed index to hashents, if any */
+EXTERN unsigned int *
+		mphdisp;	/* Perfect hash displacements, if any */
+EXTERN struct mphent *
+		mphtbl;		/* Perfect hash slots, if any */
+EXTERN unsigned int *
+		bloomfilter;	/* Negative-lookup filter, if any */
+EXTERN struct fullform *
+		fullforms;	/* Full-form table slots, if any */
+EXTERN struct fullhit *
+		fullhits;	/* Derivations of full forms, if any */
+EXTERN unsigned char *
+		fullstrings;	/* Words in full-form table, if any */
+EXTERN unsigned int *
+		nearslots;	/* Near-miss index slot starts, if any */
+EXTERN struct nearent *
+		nearents;	/* Near-miss index entries, if any */
+EXTERN unsigned char *
+		nearstrings;	/* Words in near-miss index, if any */
+EXTERN struct trienode *
+		trienodes;	/* Trie of all words, if any */
 EXTERN unsigned int
 		hashsize;	/* Size of main hash table */
 
@@ -637,18 +969,19 @@ EXTERN int	nodictflag;	/* NZ if dictionary not needed */
 EXTERN int	uerasechar;	/* User's erase character, from stty */
 EXTERN int	ukillchar;	/* User's kill character */
 
-EXTERN unsigned int laststringch; /* Number of last string character */
+#define laststringch	(curctx->c_laststringch)
+				/* Number of last string character */
 EXTERN int	defstringgroup;	/* Default string character group type */
 
 EXTERN unsigned int
 		numpflags;		/* Number of prefix flags in table */
 EXTERN unsigned int
 		numsflags;		/* Number of suffix flags in table */
-EXTERN struct flagptr pflagindex[SET_SIZE + MAXSTRINGCHARS];
-					/* Fast index to pflaglist */
+EXTERN struct affixnode *
+		pflagindex;		/* Fast index to pflaglist */
 EXTERN struct flagent *	pflaglist;	/* Prefix flag control list */
-EXTERN struct flagptr sflagindex[SET_SIZE + MAXSTRINGCHARS];
-					/* Fast index to sflaglist */
+EXTERN struct affixnode *
+		sflagindex;		/* Fast index to sflaglist */
 EXTERN struct flagent *	sflaglist;	/* Suffix flag control list */
 
 EXTERN struct strchartype *		/* String character type collection */
@@ -665,14 +998,27 @@ EXTERN int	changes;		/* NZ if changes made to cur. file */
 EXTERN int	readonly;		/* NZ if current file is readonly */
 EXTERN int	quit;			/* NZ if we're done with this file */
 
-#define MAXPOSSIBLE	100	/* Max no. of possibilities to generate */
-
-EXTERN char	possibilities[MAXPOSSIBLE][INPUTWORDLEN + MAXAFFIXLEN];
+#define possibilities	(curctx->c_possibilities)
 				/* Table of possible corrections */
-EXTERN int	pcount;		/* Count of possibilities generated */
-EXTERN int	maxposslen;	/* Length of longest possibility */
-EXTERN int	easypossibilities; /* Number of "easy" corrections found */
+#define pcount		(curctx->c_pcount)
+				/* Count of possibilities generated */
+#define maxposslen	(curctx->c_maxposslen)
+				/* Length of longest possibility */
+#define easypossibilities (curctx->c_easypossibilities)
+				/* Number of "easy" corrections found */
 				/* ..(defined as those using legal affixes) */
+#define suggestbudget	(curctx->c_budget)
+				/* Most candidates to check per word */
+#define budgetleft	(curctx->c_budgetleft)
+				/* Candidate checks left for this word */
+#define posstruncated	(curctx->c_truncated)
+				/* NZ if possibilities were cut short */
+#define nposstruncated	(curctx->c_ntruncated)
+				/* Number of words cut short */
+#define farflag		(curctx->c_farmisses)
+				/* NZ to look for words two edits away */
+#define nomemory	(curctx->c_nomem)
+				/* NZ if libispell ran out of memory */
 
 /*
  * The following array contains a list of characters that should be tried
@@ -721,7 +1067,12 @@ INIT (int deftflag, -1);		/* Default deformatting mode, chosen */
 INIT (int tflag, DEFTEXFLAG);		/* Deformatting for current file */
 INIT (int prefstringchar, -1);		/* Preferred string character type */
 
-INIT (int insidehtml, 0);		/* Flag to indicate we're amid HTML */
+EXTERN struct checkctx defctx;		/* Context of ispell's own checks */
+INIT (THREADLOCAL struct checkctx * curctx, &defctx);
+					/* Context of the current check */
+
+#define insidehtml	(curctx->c_insidehtml)
+					/* Flag to indicate we're amid HTML */
 					/*   0 = normal text */
 #define HTML_IN_TAG	0x01		/*   in <...> tag */
 #define HTML_IN_ENDTAG	0x02		/*   in </...> tag */
@@ -736,6 +1087,7 @@ INIT (int insidehtml, 0);		/* Flag to indicate we're amid HTML */
 
 INIT (int terse, 0);			/* NZ for "terse" mode */
 INIT (int correct_verbose_mode, 0);	/* NZ for "verbose" -a mode */
+INIT (int lazyposs, 0);			/* NZ to give near misses on request */
 
 INIT (char tempfile[MAXPATHLEN], "");	/* Name of file we're spelling into */
 
@@ -746,14 +1098,18 @@ INIT (int tryhardflag, -1);		/* Always call tryveryhard */
 
 INIT (char * currentfile, NULL);	/* Name of current input file */
 
+INIT (unsigned int wcgeneration, 0);	/* Bumped when verdicts may change */
+INIT (int wcstatsflag, 0);		/* NZ to report word-cache stats */
+INIT (int treeaffixed, 0);		/* NZ if pers. dict has affix flags */
+
 /* Odd numbers for math mode in LaTeX; even for LR or paragraph mode */
-INIT (int math_mode, 0);
+#define math_mode	(curctx->c_mathmode)
 /* P -- paragraph or LR mode
  * b -- parsing a \begin statement
  * e -- parsing an \end statement
  * r -- parsing a \ref type of argument.
  * m -- looking for a \begin{minipage} argument.
  */
-INIT (char LaTeX_Mode, 'P');
+#define LaTeX_Mode	(curctx->c_latexmode)
 
 #endif /* ISPELL_H_INCLUDED */
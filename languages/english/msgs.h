@@ -177,10 +177,12 @@
 #define BHASH_C_OVERFLOW	"Hash table overflowed by %d word(s).\nYou probably need to run your dictionary through munchlist.\n"
 #define BHASH_C_CANT_OPEN_DICT "Can't open dictionary\n"
 #define BHASH_C_NO_SPACE	"Couldn't allocate hash table\n"
+#define BHASH_C_MANY_MASKS	"Dictionary has over %d different sets of flags\n"
+#define BHASH_C_NO_MPH		"Couldn't find a perfect hash;  not writing one\n"
 #define BHASH_C_COLLISION_SPACE "\ncouldn't allocate space for collision\n"
 #define BHASH_C_COUNTING	"Counting words in dictionary ...\n"
 #define BHASH_C_WORD_COUNT	"\n%d words\n"
-#define BHASH_C_USAGE		"Usage:  buildhash [-s] dict-file aff-file hash-file\n\tbuildhash -c count aff-file\n"
+#define BHASH_C_USAGE		"Usage:  buildhash [-s] [-b] [-p] [-z] [-f] [-n] [-t] dict-file aff-file hash-file\n\tbuildhash -c count aff-file\n"
 
 /*
  * The following strings are used in correct.c:
@@ -231,6 +233,13 @@
 #define DEFMT_C_LR_MATH_ERROR	"***ERROR in LR to math-mode switch.%s\n"
 #define DEFMT_C_NO_SPACE	"Ran out of space building keyword list%s\n"
 
+/*
+ * The following strings are used in good.c:
+ */
+#define GOOD_C_CACHE_STATS(hits, lookups, pct, used, size, flushes) \
+				"Word cache: %lu hits in %lu lookups (%.1f%%), %d of %d entries used, emptied %lu times\n", \
+				  hits, lookups, pct, used, size, flushes
+
 /*
  * The following strings are used in icombine.c:
  */
@@ -240,12 +249,12 @@
 /*
  * The following strings are used in ispell.c:
  */
-#define ISPELL_C_USAGE1		"Usage: %s [-dfile | -pfile | -wchars | -Wn | -t | -n | -H | -x | -b | -S | -B | -C | -P | -m | -Lcontext | -M | -N | -Ttype | -ktype kws | -Fpgm | -V] file .....\n"
-#define ISPELL_C_USAGE2		"       %s [-dfile | -pfile | -wchars | -Wn | -t | -n | -H | -Ttype | -ktype kws | -Fpgm] -l\n"
+#define ISPELL_C_USAGE1		"Usage: %s [-dfile | -pfile | -wchars | -Wn | -t | -n | -H | -x | -b | -S | -B | -C | -P | -m | -E | -Lcontext | -M | -N | -Ttype | -ktype kws | -Fpgm | -V] file .....\n"
+#define ISPELL_C_USAGE2		"       %s [-dfile | -pfile | -wchars | -Wn | -t | -n | -H | -Ttype | -ktype kws | -Fpgm | -Z] -l\n"
 #ifndef USG
-#define ISPELL_C_USAGE3		"       %s [-dfile | -pfile | -ffile | -Wn | -t | -n | -H | -s | -B | -C | -P | -m | -Ttype | -ktype kws | -Fpgm] [-a | -A]\n"
+#define ISPELL_C_USAGE3		"       %s [-dfile | -pfile | -ffile | -Wn | -t | -n | -H | -s | -B | -C | -P | -m | -E | -q | -Gcount | -Ttype | -ktype kws | -Fpgm | -Z] [-a | -A]\n"
 #else
-#define ISPELL_C_USAGE3		"       %s [-dfile | -pfile | -ffile | -Wn | -t | -n | -H | -B | -C | -P | -m | -Ttype | -ktype kws | -Fpgm] [-a | -A]\n"
+#define ISPELL_C_USAGE3		"       %s [-dfile | -pfile | -ffile | -Wn | -t | -n | -H | -B | -C | -P | -m | -E | -q | -Gcount | -Ttype | -ktype kws | -Fpgm | -Z] [-a | -A]\n"
 #endif
 #define ISPELL_C_USAGE4		"       %s [-dfile] [-wchars | -Wn] -c\n"
 #define ISPELL_C_USAGE5		"       %s [-dfile] [-wchars] -e[1-4]\n"
@@ -256,6 +265,8 @@
 #define ISPELL_C_NO_FILE	"ispell:  specified file does not exist\n"
 #define ISPELL_C_NO_FILES	"ispell:  specified files do not exist\n"
 #define ISPELL_C_CANT_WRITE	"Warning:  Can't write to %s%s\n"
+#define ISPELL_C_BUDGET_STATS(n) \
+				"Suggestions: %ld words cut short by -G\n", n
 #define ISPELL_C_OPTIONS_ARE	"Compiled-in options:\n"
 #define ISPELL_C_UNEXPECTED_FD	"ispell:  unexpected fd while opening '%s'%s\n"
 #define ISPELL_C_NO_OPTIONS_SPACE "ispell: no memory to read default options\n"
@@ -312,6 +323,8 @@
 #define PARSE_Y_NO_SPACE	"Out of memory"
 #define PARSE_Y_NEED_BLANK	"Single characters must be separated by a blank"
 #define PARSE_Y_MANY_CONDS	"Too many conditions;  8 maximum"
+#define PARSE_Y_LONG_AFFIX	"Affix string too long"
+#define PARSE_Y_MANY_CLASSES	"Too many different characters in affix conditions;  increase MAXCONDCLASSES"
 #define PARSE_Y_EOF		"Unexpected EOF in quoted string"
 #define PARSE_Y_LONG_QUOTE	"Quoted string too long, max 256 characters"
 #define PARSE_Y_ERROR_FORMAT(file, lineno, error) \
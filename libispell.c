@@ -0,0 +1,321 @@
+#ifndef lint
+static char Rcs_Id[] =
+    "$Id$";
+#endif
+
+/*
+ * Library interface to ispell's checker; see libispell.h.
+ *
+ * This file takes the place of ispell.c in libispell:  it owns the
+ * global variables (by defining MAIN) and does the setup that ispell's
+ * main() does before checking words.  The routines here then wrap
+ * good(), compoundgood(), makepossibilities(), and the personal
+ * dictionary in calls that need no terminal or open files.
+ */
+
+#define MAIN			/* Define the globals here */
+#include "config.h"
+#include "ispell.h"
+#include "proto.h"
+#include "msgs.h"
+#include "libispell.h"
+
+struct ispell_handle
+    {
+    struct checkctx *	h_ctx;		/* Checker state for this handle */
+    };
+
+int		ispell_init P ((const char * hashfile, const char * persdict));
+ispell_t *	ispell_open P ((void));
+void		ispell_close P ((ispell_t * handle));
+int		ispell_check P ((ispell_t * handle, const char * word));
+static int	checkword P ((ichar_t * itok, unsigned char * ctok));
+int		ispell_suggest P ((ispell_t * handle, const char * word,
+		  char * buf, unsigned int bufsize));
+void		ispell_setbudget P ((ispell_t * handle, long budget));
+long		ispell_truncations P ((ispell_t * handle));
+void		ispell_setfarmisses P ((ispell_t * handle, int on));
+int		ispell_addword P ((ispell_t * handle, const char * word,
+		  int keep));
+void		ispell_savedict P ((void));
+
+static int	dictloaded = 0;		/* NZ once ispell_init succeeds */
+
+/*
+ * Load the dictionary in hashfile, plus the personal dictionary
+ * persdict (either may be NULL to get ispell's defaults).  This must
+ * be done exactly once, before any other call.  Returns 0 on success
+ * and -1 if the dictionary couldn't be loaded.
+ */
+int ispell_init (hashfile, persdict)
+    const char *	hashfile;	/* Hash file to load, or NULL */
+    const char *	persdict;	/* Personal dictionary, or NULL */
+    {
+    char		libdictname[MAXPATHLEN]; /* Root of hash file name */
+    char *		p;
+
+    if (dictloaded)
+	return -1;
+    if (hashfile == NULL)
+	(void) sprintf (hashname, "%s/%s", LIBDIR, DEFHASH);
+    else if (strlen (hashfile) >= sizeof hashname)
+	return -1;
+    else
+	(void) strcpy (hashname, hashfile);
+
+    /*
+    ** Behave like "ispell -a": never pause for warnings, and don't
+    ** print anything while checking.
+    */
+    aflag = 1;
+    defctx.c_latexmode = 'P';
+    if (linit () < 0)
+	return -1;
+    defstringgroup = 0;
+    if (compoundflag < 0)
+	compoundflag = hashheader.compoundflag;
+    if (tryhardflag < 0)
+	tryhardflag = hashheader.defhardflag;
+    initckch ((char *) NULL);
+
+    /*
+    ** The personal dictionary is named after the hash file, just as
+    ** ispell names it after the -d switch.
+    */
+    p = rindex (hashname, '/');
+    (void) strcpy (libdictname, p == NULL ? hashname : p + 1);
+    p = rindex (libdictname, '.');
+    if (p != NULL  &&  strcmp (p, HASHSUFFIX) == 0)
+	*p = '\0';
+    nomemory = 0;
+    treeinit ((char *) persdict, libdictname);
+    if (nomemory)
+	return -1;
+    dictloaded = 1;
+    return 0;
+    }
+
+/*
+ * Make a new handle, with its own checker context.  Returns NULL if
+ * there's no memory.
+ */
+ispell_t * ispell_open ()
+    {
+    ispell_t *		handle;
+
+    handle = (ispell_t *) malloc (sizeof (ispell_t));
+    if (handle == NULL)
+	return NULL;
+    handle->h_ctx = newckctx ();
+    if (handle->h_ctx == NULL)
+	{
+	free ((char *) handle);
+	return NULL;
+	}
+    return handle;
+    }
+
+void ispell_close (handle)
+    ispell_t *		handle;		/* Handle to release */
+    {
+
+    freeckctx (handle->h_ctx);
+    free ((char *) handle);
+    }
+
+/*
+ * Check a word, giving the same answer that "ispell -a" would.
+ */
+int ispell_check (handle, word)
+    ispell_t *		handle;		/* Handle to check with */
+    const char *	word;		/* Word to check */
+    {
+    struct checkctx *	oldctx;
+    ichar_t		itok[INPUTWORDLEN + MAXAFFIXLEN];
+    int			result;
+
+    oldctx = setckctx (handle->h_ctx);
+    nomemory = 0;
+    if (strtoichar (itok, (unsigned char *) word, sizeof itok, 0))
+	result = ISPELL_ERROR;
+    else
+	result = checkword (itok, (unsigned char *) word);
+    if (nomemory)
+	result = ISPELL_ERROR;
+    (void) setckctx (oldctx);
+    return result;
+    }
+
+/*
+ * Internal version of ispell_check, for use in the current context.
+ * This mirrors the tests that checkline() makes in -a mode.
+ */
+static int checkword (itok, ctok)
+    ichar_t *		itok;		/* Word to check */
+    unsigned char *	ctok;		/* Same word, as given */
+    {
+    int			verdict;
+    struct dent *	root;
+
+    if (icharlen (itok) <= minword)
+	return ISPELL_OK;
+    verdict = goodcachelookup (itok, &root);
+    if (verdict == GOOD_UNKNOWN)
+	{
+	if (good (itok, 0, 0, 0, 0))
+	    {
+	    if (hits[0].prefix == NULL  &&  hits[0].suffix == NULL)
+		verdict = GOOD_OK;
+	    else
+		verdict = GOOD_ROOT;
+	    }
+	else if (compoundgood (itok, 0))
+	    verdict = GOOD_COMPOUND;
+	else
+	    verdict = GOOD_MISS;
+	if (nomemory)
+	    return ISPELL_ERROR;	/* Don't remember a wrong verdict */
+	goodcacheenter (itok, verdict,
+	  verdict == GOOD_ROOT ? hits[0].dictent : (struct dent *) NULL);
+	}
+    if (verdict != GOOD_MISS)
+	return verdict;		/* GOOD_xxx match ISPELL_xxx */
+    /*
+    ** See inpossibilities() for why a word can be good even though
+    ** good() rejected it.  Most misses can't be, and finding out costs
+    ** a full round of near misses, so don't try unless it's possible.
+    */
+    if (!needinposs (itok))
+	return ISPELL_MISS;
+    makepossibilities (itok);
+    if (inpossibilities (ctok))
+	return ISPELL_OK;
+    return ISPELL_MISS;
+    }
+
+/*
+ * Generate the near misses for a word and store them in buf, in the
+ * order that "ispell -a" lists them.  Each one is null-terminated,
+ * and the list ends with an empty string.  Suggestions that don't fit
+ * in buf are dropped.  Returns the number of suggestions stored, or
+ * ISPELL_ERROR if the word couldn't be converted, buf is too small
+ * even for the terminator, or memory ran out.
+ */
+int ispell_suggest (handle, word, buf, bufsize)
+    ispell_t *		handle;		/* Handle to check with */
+    const char *	word;		/* Misspelled word */
+    char *		buf;		/* Where to store suggestions */
+    unsigned int	bufsize;	/* Size of buf */
+    {
+    struct checkctx *	oldctx;
+    ichar_t		itok[INPUTWORDLEN + MAXAFFIXLEN];
+    register int	i;
+    unsigned int	len;
+    int			nstored;
+
+    if (bufsize == 0)
+	return ISPELL_ERROR;
+    oldctx = setckctx (handle->h_ctx);
+    if (strtoichar (itok, (unsigned char *) word, sizeof itok, 0))
+	{
+	(void) setckctx (oldctx);
+	return ISPELL_ERROR;
+	}
+    nomemory = 0;
+    makepossibilities (itok);
+    if (nomemory)
+	{
+	(void) setckctx (oldctx);
+	return ISPELL_ERROR;
+	}
+    nstored = 0;
+    for (i = 0;  i < pcount;  i++)
+	{
+	len = strlen (possibilities[i]) + 1;
+	if (len >= bufsize)
+	    continue;
+	(void) strcpy (buf, possibilities[i]);
+	buf += len;
+	bufsize -= len;
+	nstored++;
+	}
+    *buf = '\0';
+    (void) setckctx (oldctx);
+    return nstored;
+    }
+
+/*
+ * Limit the number of candidate words checked while finding each
+ * suggestion list with this handle, as the -G switch does for ispell.
+ * Zero (the default) removes the limit.
+ */
+void ispell_setbudget (handle, budget)
+    ispell_t *		handle;		/* Handle to limit */
+    long		budget;		/* Most checks per list, 0=any */
+    {
+
+    handle->h_ctx->c_budget = budget < 0 ? 0 : budget;
+    }
+
+/*
+ * Return the number of suggestion lists, made with this handle by
+ * ispell_suggest or ispell_check, that were cut short by the limit
+ * set with ispell_setbudget.
+ */
+long ispell_truncations (handle)
+    ispell_t *		handle;		/* Handle to report on */
+    {
+
+    return handle->h_ctx->c_ntruncated;
+    }
+
+/*
+ * Choose whether suggestions made with this handle include words two
+ * changes from the misspelling when nothing closer is found, as with
+ * "ispell -E".  This only has an effect if the hash file has a trie.
+ */
+void ispell_setfarmisses (handle, on)
+    ispell_t *		handle;		/* Handle to set */
+    int			on;		/* NZ to look two edits away */
+    {
+
+    handle->h_ctx->c_farmisses = on != 0;
+    }
+
+/*
+ * Accept a word for the rest of the session.  If keep is nonzero,
+ * the word also goes into the personal dictionary when
+ * ispell_savedict is called, as with the "*" command of "ispell -a".
+ * Returns 0 on success, or ISPELL_ERROR if the word is too long or
+ * there's no memory for it.
+ */
+int ispell_addword (handle, word, keep)
+    ispell_t *		handle;		/* Handle to convert with */
+    const char *	word;		/* Word to accept */
+    int			keep;		/* NZ to save in personal dict */
+    {
+    struct checkctx *	oldctx;
+    ichar_t		itok[INPUTWORDLEN + MAXAFFIXLEN];
+    int			result;
+
+    oldctx = setckctx (handle->h_ctx);
+    if (strtoichar (itok, (unsigned char *) word, sizeof itok, 0))
+	{
+	(void) setckctx (oldctx);
+	return ISPELL_ERROR;
+	}
+    nomemory = 0;
+    treeinsert (ichartosstr (itok, 1), ICHARTOSSTR_SIZE, keep);
+    result = nomemory ? ISPELL_ERROR : 0;
+    (void) setckctx (oldctx);
+    return result;
+    }
+
+/*
+ * Write out the personal dictionary, if any kept words were added.
+ */
+void ispell_savedict ()
+    {
+
+    treeoutput ();
+    }
@@ -0,0 +1,117 @@
+#ifndef LIBISPELL_H_INCLUDED
+#define LIBISPELL_H_INCLUDED
+/*
+ * $Id$
+ */
+
+/*
+ * Interface to libispell, ispell's checker packaged as a library
+ * (libispell.a or libispell.so) for use by other programs.
+ *
+ * The library contains only the dictionary, lookup, and suggestion
+ * code.  It never touches the terminal, never reads or writes the
+ * standard streams, and never exits; words go in and results come
+ * back through arguments and caller-supplied buffers, and failures
+ * (a bad hash file, or running out of memory) are reported by the
+ * return values.  Built as a shared library, it exports only the
+ * ispell_ functions below.  Use it like this:
+ *
+ *     ispell_t *	h;
+ *     char		buf[1024];
+ *     char *		p;
+ *
+ *     if (ispell_init ("/usr/local/lib/english.hash", NULL) < 0)
+ *         ...
+ *     h = ispell_open ();
+ *     if (ispell_check (h, word) == ISPELL_MISS)
+ *         {
+ *         (void) ispell_suggest (h, word, buf, sizeof buf);
+ *         for (p = buf;  *p != '\0';  p += strlen (p) + 1)
+ *             printf ("did you mean %s?\n", p);
+ *         }
+ *     ispell_close (h);
+ *
+ * Words are given in the character set of the hash file, exactly as
+ * they would be given to "ispell -a".
+ *
+ * Finding suggestions for a long or badly garbled word can take a
+ * while.  ispell_setbudget limits the number of candidate words
+ * checked for each suggestion list, as "ispell -G" does;  a list that
+ * hits the limit holds only what was found before then, and is counted
+ * by ispell_truncations.  ispell_setfarmisses makes ispell_suggest
+ * also offer words two changes away, as "ispell -E" does.
+ *
+ * There is one dictionary per process, loaded by ispell_init.  Each
+ * handle from ispell_open carries its own checker state, so separate
+ * threads can check words concurrently with separate handles if
+ * libispell was built with THREADLOCAL set up (see config.X).  A
+ * handle must not be used by two threads at once, and ispell_addword
+ * and ispell_savedict must not run concurrently with anything else.
+ */
+
+typedef struct ispell_handle ispell_t;
+
+/*
+ * Results of ispell_check.  These correspond to the "*", "+", "-",
+ * and "&"/"#" responses of "ispell -a".
+ */
+#define ISPELL_ERROR	(-1)	/* Word too long, or no memory */
+#define ISPELL_MISS	0	/* Word is misspelled */
+#define ISPELL_OK	1	/* Word is in the dictionary as given */
+#define ISPELL_ROOT	2	/* Word is a root plus affixes */
+#define ISPELL_COMPOUND	3	/* Word is a legal compound */
+
+#undef P
+#ifdef __STDC__
+#define P(x)	x
+#else /* __STDC__ */
+#define P(x)	()
+#endif /* __STDC__ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/*
+ * Libispell's own objects are compiled with hidden visibility (see
+ * PICFLAGS in config.X), so that its internals can't clash with the
+ * caller's names;  these are the only symbols it exports.
+ */
+#if defined (__GNUC__)  &&  __GNUC__ >= 4
+#pragma GCC visibility push (default)
+#endif /* __GNUC__ */
+
+extern int		ispell_init P ((const char * hashfile,
+			  const char * persdict));
+				/* Load dictionaries; 0 if OK, -1 if not */
+extern ispell_t *	ispell_open P ((void));
+				/* Make a handle; NULL if no memory */
+extern void		ispell_close P ((ispell_t * handle));
+				/* Release a handle */
+extern int		ispell_check P ((ispell_t * handle,
+			  const char * word));
+				/* Check a word; returns ISPELL_xxx */
+extern int		ispell_suggest P ((ispell_t * handle,
+			  const char * word, char * buf, unsigned int bufsize));
+				/* Get near misses; returns count stored */
+extern void		ispell_setbudget P ((ispell_t * handle, long budget));
+				/* Limit checks per suggestion; 0=none */
+extern long		ispell_truncations P ((ispell_t * handle));
+				/* Number of suggestion lists cut short */
+extern void		ispell_setfarmisses P ((ispell_t * handle, int on));
+				/* NZ to suggest words two edits away */
+extern int		ispell_addword P ((ispell_t * handle,
+			  const char * word, int keep));
+				/* Accept a word; 0 if OK, -1 if not */
+extern void		ispell_savedict P ((void));
+				/* Write the personal dictionary */
+
+#if defined (__GNUC__)  &&  __GNUC__ >= 4
+#pragma GCC visibility pop
+#endif /* __GNUC__ */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* LIBISPELL_H_INCLUDED */
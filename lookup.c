@@ -103,15 +103,46 @@ static char Rcs_Id[] =
 #include "proto.h"
 #include "msgs.h"
 #include <fcntl.h>
+#include <sys/stat.h>
+#ifndef NO_MMAP
+#include <sys/mman.h>
+#endif /* NO_MMAP */
+
+#define DENTPOOLSIZE	128	/* Entries loaddent mallocs at once */
 
 int		linit P ((void));
 #ifdef INDEXDUMP
-static void	dumpindex P ((struct flagptr * indexp, int depth));
+static void	dumpindex P ((struct affixnode * node,
+		  struct affixnode * flagindex, struct flagent * list, int depth));
 #endif /* INDEXDUMP */
 struct dent *	lookup P ((ichar_t * word, int dotree));
+void		lookupbatch P ((ichar_t ** words, int nwords,
+		  struct dent ** results, int dotree));
+static unsigned int chainlookup P ((ichar_t * word, unsigned char * schar,
+		  unsigned int index, unsigned int fprint));
+static unsigned int bucketlookup P ((ichar_t * word, unsigned char * schar,
+		  unsigned int bucketno, unsigned int fprint));
+static unsigned int mphlookup P ((ichar_t * word, unsigned char * schar,
+		  unsigned int key, unsigned int check));
+static int	sameword P ((unsigned int index, ichar_t * word,
+		  unsigned char * schar));
+struct fullhit * fullformlookup P ((ichar_t * word, unsigned int * nhitsp));
+struct dent *	loaddent P ((unsigned int index));
 
 static int	inited = 0;
 
+/*
+** State of one word's lookup in lookupbatch.
+*/
+struct batchprobe
+    {
+    unsigned int	key;		/* Word's key from mphkey */
+    unsigned int	check;		/* Word's check value from mphkey */
+    unsigned int	fprint;		/* Word's fingerprint */
+    unsigned int	index;		/* Index slot or table entry probed */
+    unsigned int	ent;		/* Entry that may hold the word */
+    };
+
 /*
  * Default character type if no type is given
  */
@@ -127,19 +158,16 @@ int linit ()
     {
     int			hashfd;
     register int	i;
-    register struct dent * dp;
-    struct flagent *	entry;
-    struct flagptr *	ind;
     int			nextchar;
-    int			viazero;
-    register ichar_t *	cp;
+    struct stat		statbuf;
+    unsigned char *	hashfile;
 
     if (inited)
 	return 0;
 
     if ((hashfd = open (hashname, 0 | MSDOS_BINARY_OPEN)) < 0)
 	{
-	(void) fprintf (stderr, CANT_OPEN, hashname, MAYBE_CR (stderr));
+	DIAG ((stderr, CANT_OPEN, hashname, MAYBE_CR (stderr)));
 	return (-1);
 	}
 
@@ -147,284 +175,147 @@ int linit ()
     if (hashsize < sizeof hashheader)
 	{
 	if (hashsize == (unsigned int) -1)
-	    (void) fprintf (stderr, LOOKUP_C_CANT_READ, hashname,
-	      MAYBE_CR (stderr));
+	    DIAG ((stderr, LOOKUP_C_CANT_READ, hashname,
+	      MAYBE_CR (stderr)));
 	else if (hashsize == 0)
-	    (void) fprintf (stderr, LOOKUP_C_NULL_HASH, hashname,
-	      MAYBE_CR (stderr));
+	    DIAG ((stderr, LOOKUP_C_NULL_HASH, hashname,
+	      MAYBE_CR (stderr)));
 	else
-	    (void) fprintf (stderr,
+	    DIAG ((stderr,
 	      LOOKUP_C_SHORT_HASH (hashname, hashsize,
-	        (int) sizeof hashheader), MAYBE_CR (stderr));
+	        (int) sizeof hashheader), MAYBE_CR (stderr)));
 	return (-1);
 	}
     else if (hashheader.magic != MAGIC)
 	{
-	(void) fprintf (stderr,
+	DIAG ((stderr,
 	  LOOKUP_C_BAD_MAGIC (hashname, (unsigned int) MAGIC,
-	    (unsigned int) hashheader.magic), MAYBE_CR (stderr));
+	    (unsigned int) hashheader.magic), MAYBE_CR (stderr)));
 	return (-1);
 	}
     else if (hashheader.magic2 != MAGIC)
 	{
-	(void) fprintf (stderr,
+	DIAG ((stderr,
 	  LOOKUP_C_BAD_MAGIC2 (hashname, (unsigned int) MAGIC,
-	    (unsigned int) hashheader.magic2), MAYBE_CR (stderr));
+	    (unsigned int) hashheader.magic2), MAYBE_CR (stderr)));
 	return (-1);
 	}
     else if (hashheader.compileoptions != COMPILEOPTIONS
       ||  hashheader.maxstringchars != MAXSTRINGCHARS
       ||  hashheader.maxstringcharlen != MAXSTRINGCHARLEN)
 	{
-	(void) fprintf (stderr,
+	DIAG ((stderr,
 	  LOOKUP_C_BAD_OPTIONS ((unsigned int) hashheader.compileoptions,
 	    hashheader.maxstringchars, hashheader.maxstringcharlen,
 	    (unsigned int) COMPILEOPTIONS, MAXSTRINGCHARS, MAXSTRINGCHARLEN),
-	    MAYBE_CR (stderr));
+	    MAYBE_CR (stderr)));
 	return (-1);
 	}
-    if (nodictflag)
-	{
-	/*
-	 * Dictionary is not needed - create an empty dummy table.  We
-	 * actually have to have one entry since the hash
-	 * algorithm involves a divide by the table size
-	 * (actually modulo, but zero is still unacceptable).
-	 * So we create an empty entry.
-	 */
-	hashsize = 1;		/* This prevents divides by zero */
-	hashtbl = (struct dent *) calloc (1, sizeof (struct dent));
-	if (hashtbl == NULL)
-	    {
-	    (void) fprintf (stderr, LOOKUP_C_NO_HASH_SPACE, MAYBE_CR (stderr));
-	    return (-1);
-	    }
-	hashtbl[0].word = NULL;
-	hashtbl[0].next = NULL;
-	hashtbl[0].flagfield &= ~(USED | KEEP);
-	/* The flag bits don't matter, but calloc cleared them. */
-	hashstrings =
-	  (unsigned char *) malloc ((unsigned) hashheader.lstringsize);
-	}
-    else
-	{
-	hashtbl =
-	 (struct dent *)
-	    malloc ((unsigned) hashheader.tblsize * sizeof (struct dent));
-	hashsize = hashheader.tblsize;
-	hashstrings =
-	  (unsigned char *) malloc ((unsigned) hashheader.stringsize);
-	}
-    numsflags = hashheader.stblsize;
-    numpflags = hashheader.ptblsize;
-    sflaglist = (struct flagent *)
-      malloc ((numsflags + numpflags) * sizeof (struct flagent));
-    if (hashtbl == NULL  ||  hashstrings == NULL  ||  sflaglist == NULL)
+    if (fstat (hashfd, &statbuf) < 0
+      ||  (unsigned long) statbuf.st_size < hashheader.filesize)
 	{
-	(void) fprintf (stderr, LOOKUP_C_NO_HASH_SPACE, MAYBE_CR (stderr));
+	DIAG ((stderr, LOOKUP_C_BAD_FORMAT, MAYBE_CR (stderr)));
 	return (-1);
 	}
-    pflaglist = sflaglist + numsflags;
 
-    if (nodictflag)
+    /*
+    ** The hash file is designed to be used exactly as it sits on the
+    ** disk.  If we can, we map it, so that startup costs nothing no
+    ** matter how big the dictionary is, and so that all copies of
+    ** ispell using the same dictionary share a single copy in memory.
+    ** The mapping is private and writable because ispell occasionally
+    ** changes a word in place (e.g., addvheader upcases the word when a
+    ** personal-dictionary word makes it a variant header);  only the
+    ** pages so changed are copied.  Otherwise, read the file into
+    ** memory in one gulp.
+    */
+    hashfile = NULL;
+#ifndef NO_MMAP
+    hashfile = (unsigned char *) mmap ((VOID *) NULL,
+      (size_t) hashheader.filesize, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+      hashfd, (off_t) 0);
+    if (hashfile == (unsigned char *) MAP_FAILED)
+	hashfile = NULL;
+#endif /* NO_MMAP */
+    if (hashfile == NULL)
 	{
-	/*
-	 * Read just the strings for the language table, and
-	 * skip over the rest of the strings and all of the
-	 * hash table.
-	 */
-	if (read (hashfd, hashstrings, (unsigned) hashheader.lstringsize)
-	  != (int) hashheader.lstringsize)
+	hashfile = (unsigned char *) malloc ((unsigned) hashheader.filesize);
+	if (hashfile == NULL)
 	    {
-	    (void) fprintf (stderr, LOOKUP_C_BAD_FORMAT, MAYBE_CR (stderr));
+	    DIAG ((stderr, LOOKUP_C_NO_HASH_SPACE,
+	      MAYBE_CR (stderr)));
 	    return (-1);
 	    }
-	(void) lseek (hashfd,
-	  (off_t) hashheader.stringsize - (off_t) hashheader.lstringsize
-	    + (off_t) hashheader.tblsize * (off_t) sizeof (struct dent),
-	  1);
-	}
-    else
-	{
-	if (read (hashfd, hashstrings, (unsigned) hashheader.stringsize)
-	    != (int) hashheader.stringsize
-	  ||  read (hashfd, (char *) hashtbl,
-	      (unsigned) hashheader.tblsize * sizeof (struct dent))
-	    != (int) (hashheader.tblsize * sizeof (struct dent)))
+	if (lseek (hashfd, (off_t) 0, 0) != 0
+	  ||  read (hashfd, (char *) hashfile, (unsigned) hashheader.filesize)
+	    != (int) hashheader.filesize)
 	    {
-	    (void) fprintf (stderr, LOOKUP_C_BAD_FORMAT, MAYBE_CR (stderr));
+	    DIAG ((stderr, LOOKUP_C_BAD_FORMAT, MAYBE_CR (stderr)));
 	    return (-1);
 	    }
 	}
-    if ((unsigned) read (hashfd, (char *) sflaglist,
-	(unsigned) (numsflags + numpflags) * sizeof (struct flagent))
-      != (numsflags + numpflags) * sizeof (struct flagent))
-	{
-	(void) fprintf (stderr, LOOKUP_C_BAD_FORMAT, MAYBE_CR (stderr));
-	return (-1);
-	}
     (void) close (hashfd);
 
-    if (!nodictflag)
+    hashstrings = hashfile + hashheader.stringstart;
+    hashents = (struct hashdent *) (hashfile + hashheader.tblstart);
+    hashmasks = (struct hashmask *) (hashfile + hashheader.maskstart);
+    hashsize = hashheader.tblsize;
+    numsflags = hashheader.stblsize;
+    numpflags = hashheader.ptblsize;
+    sflaglist = (struct flagent *) (hashfile + hashheader.flagstart);
+    pflaglist = sflaglist + numsflags;
+    sflagindex = (struct affixnode *) (hashfile + hashheader.sindexstart);
+    pflagindex = (struct affixnode *) (hashfile + hashheader.pindexstart);
+    if (hashheader.nbuckets != 0)
+	hashbuckets =
+	  (struct hashbucket *) (hashfile + hashheader.bucketstart);
+    if (hashheader.nmphdisps != 0)
 	{
-	for (i = hashsize, dp = hashtbl;  --i >= 0;  dp++)
-	    {
-	    if (dp->word == (unsigned char *) -1)
-		dp->word = NULL;
-	    else
-		dp->word = &hashstrings[(unsigned long) dp->word];
-	    if (dp->next == (struct dent *) -1)
-		dp->next = NULL;
-	    else
-		dp->next = &hashtbl[(unsigned long) dp->next];
-	    }
+	mphdisp = (unsigned int *) (hashfile + hashheader.mphstart);
+	mphtbl = (struct mphent *) (mphdisp + hashheader.nmphdisps);
 	}
-
-    for (i = numsflags + numpflags, entry = sflaglist; --i >= 0; entry++)
+    if (hashheader.nbloomblocks != 0)
+	bloomfilter = (unsigned int *) (hashfile + hashheader.bloomstart);
+    if (hashheader.nfullslots != 0)
 	{
-	if (entry->stripl)
-	    entry->strip =
-	      (ichar_t *) &hashstrings[(unsigned long) entry->strip];
-	else
-	    entry->strip = NULL;
-	if (entry->affl)
-	    entry->affix =
-	      (ichar_t *) &hashstrings[(unsigned long) entry->affix];
-	else
-	    entry->affix = NULL;
+	fullforms = (struct fullform *) (hashfile + hashheader.fullstart);
+	fullhits = (struct fullhit *) (fullforms + hashheader.nfullslots);
+	fullstrings = (unsigned char *) (fullhits + hashheader.nfullhits);
 	}
-    /*
-    ** Warning - 'entry' and 'i' are reset in the body of the loop
-    ** below.  Don't try to optimize it by (e.g.) moving the decrement
-    ** of i into the loop condition.
-    */
-    for (i = numsflags, entry = sflaglist;  i > 0;  i--, entry++)
+    if (hashheader.nnearslots != 0)
 	{
-	if (entry->affl == 0)
-	    {
-	    cp = NULL;
-	    ind = &sflagindex[0];
-	    viazero = 1;
-	    }
-	else
-	    {
-	    cp = entry->affix + entry->affl - 1;
-	    ind = &sflagindex[*cp];
-	    viazero = 0;
-	    while (ind->numents == 0  &&  ind->pu.fp != NULL)
-		{
-		if (cp == entry->affix)
-		    {
-		    ind = &ind->pu.fp[0];
-		    viazero = 1;
-		    }
-		else
-		    {
-		    ind = &ind->pu.fp[*--cp];
-		    viazero = 0;
-		    }
-		}
-	    }
-	if (ind->numents == 0)
-	    ind->pu.ent = entry;
-	ind->numents++;
-	/*
-	** If this index entry has more than MAXSEARCH flags in
-	** it, we will split it into subentries to reduce the
-	** searching.  However, the split doesn't make sense in
-	** two cases:  (a) if we are already at the end of the
-	** current affix, or (b) if all the entries in the list
-	** have identical affixes.  Since the list is sorted, (b)
-	** is true if the first and last affixes in the list
-	** are identical.
-	*/
-	if (!viazero  &&  ind->numents >= MAXSEARCH
-	  &&  icharcmp (entry->affix, ind->pu.ent->affix) != 0)
-	    {
-	    /* Sneaky trick:  back up and reprocess */
-	    entry = ind->pu.ent - 1; /* -1 is for entry++ in loop */
-	    i = numsflags - (entry - sflaglist);
-	    ind->pu.fp =
-	      (struct flagptr *)
-		calloc ((unsigned) (SET_SIZE + hashheader.nstrchars),
-		  sizeof (struct flagptr));
-	    if (ind->pu.fp == NULL)
-		{
-		(void) fprintf (stderr, LOOKUP_C_NO_LANG_SPACE,
-		  MAYBE_CR (stderr));
-		return (-1);
-		}
-	    ind->numents = 0;
-	    }
+	nearslots = (unsigned int *) (hashfile + hashheader.nearstart);
+	nearents = (struct nearent *) (nearslots + hashheader.nnearslots + 1);
+	nearstrings = (unsigned char *) (nearents + hashheader.nnearents);
 	}
+    if (hashheader.ntrienodes != 0)
+	trienodes = (struct trienode *) (hashfile + hashheader.triestart);
+    if (hashheader.packedwords)
+	packinit ();
+
     /*
-    ** Warning - 'entry' and 'i' are reset in the body of the loop
-    ** below.  Don't try to optimize it by (e.g.) moving the decrement
-    ** of i into the loop condition.
+    ** Hashdentp points to the usable (struct dent) versions of entries
+    ** in hashents.  An entry is filled in by lookup the first time it
+    ** is found, so only the entries actually used ever occupy memory,
+    ** and they are packed together rather than scattered through a
+    ** table the size of the dictionary.  Since calloc will normally get
+    ** large tables directly from the operating system as demand-zero
+    ** pages, the pointer table is cheap no matter how big it is.
     */
-    for (i = numpflags, entry = pflaglist;  i > 0;  i--, entry++)
+    hashdentp = (struct dent **)
+      calloc ((unsigned) (hashsize + hashheader.nvariants),
+	sizeof (struct dent *));
+    if (hashdentp == NULL)
 	{
-	if (entry->affl == 0)
-	    {
-	    cp = NULL;
-	    ind = &pflagindex[0];
-	    viazero = 1;
-	    }
-	else
-	    {
-	    cp = entry->affix;
-	    ind = &pflagindex[*cp++];
-	    viazero = 0;
-	    while (ind->numents == 0  &&  ind->pu.fp != NULL)
-		{
-		if (*cp == 0)
-		    {
-		    ind = &ind->pu.fp[0];
-		    viazero = 1;
-		    }
-		else
-		    {
-		    ind = &ind->pu.fp[*cp++];
-		    viazero = 0;
-		    }
-		}
-	    }
-	if (ind->numents == 0)
-	    ind->pu.ent = entry;
-	ind->numents++;
-	/*
-	** If this index entry has more than MAXSEARCH flags in
-	** it, we will split it into subentries to reduce the
-	** searching.  However, the split doesn't make sense in
-	** two cases:  (a) if we are already at the end of the
-	** current affix, or (b) if all the entries in the list
-	** have identical affixes.  Since the list is sorted, (b)
-	** is true if the first and last affixes in the list
-	** are identical.
-	*/
-	if (!viazero  &&  ind->numents >= MAXSEARCH
-	  &&  icharcmp (entry->affix, ind->pu.ent->affix) != 0)
-	    {
-	    /* Sneaky trick:  back up and reprocess */
-	    entry = ind->pu.ent - 1; /* -1 is for entry++ in loop */
-	    i = numpflags - (entry - pflaglist);
-	    ind->pu.fp =
-	      (struct flagptr *) calloc (SET_SIZE + hashheader.nstrchars,
-	        sizeof (struct flagptr));
-	    if (ind->pu.fp == NULL)
-		{
-		(void) fprintf (stderr, LOOKUP_C_NO_LANG_SPACE,
-		  MAYBE_CR (stderr));
-		return (-1);
-		}
-	    ind->numents = 0;
-	    }
+	DIAG ((stderr, LOOKUP_C_NO_HASH_SPACE, MAYBE_CR (stderr)));
+	return (-1);
 	}
+
 #ifdef INDEXDUMP
     (void) fprintf (stderr, "Prefix index table:\n");
-    dumpindex (pflagindex, 0);
+    dumpindex (pflagindex, pflagindex, pflaglist, 0);
     (void) fprintf (stderr, "Suffix index table:\n");
-    dumpindex (sflagindex, 0);
+    dumpindex (sflagindex, sflagindex, sflaglist, 0);
 #endif
     if (hashheader.nstrchartype == 0)
 	chartypes = &deftype;
@@ -434,7 +325,7 @@ int linit ()
 	  malloc (hashheader.nstrchartype * sizeof (struct strchartype));
 	if (chartypes == NULL)
 	    {
-	    (void) fprintf (stderr, LOOKUP_C_NO_LANG_SPACE, MAYBE_CR (stderr));
+	    DIAG ((stderr, LOOKUP_C_NO_LANG_SPACE, MAYBE_CR (stderr)));
 	    return (-1);
 	    }
 	for (i = 0, nextchar = hashheader.strtypestart;
@@ -457,88 +348,489 @@ int linit ()
     }
 
 #ifdef INDEXDUMP
-static void dumpindex (indexp, depth)
-    register struct flagptr *	indexp;
+static void dumpindex (node, flagindex, list, depth)
+    register struct affixnode *	node;		/* Subtree to dump */
+    struct affixnode *		flagindex;	/* Trie containing it */
+    struct flagent *		list;		/* Flags it indexes */
     register int		depth;
     {
-    register int		i;
+    register unsigned int	i;
     int				j;
-    int				k;
+    unsigned int		k;
     char			stripbuf[INPUTWORDLEN + 4 * MAXAFFIXLEN + 4];
 
-    for (i = 0;  i < SET_SIZE + hashheader.nstrchars;  i++, indexp++)
+    for (j = depth;  --j >= 0;  )
+	(void) putc (' ', stderr);
+    if (depth == 0)
+	(void) fputs ("(root)", stderr);
+    else if (node->ch >= ' '  &&  node->ch <= '~')
+	(void) putc (node->ch, stderr);
+    else
+	(void) fprintf (stderr, "0x%x", node->ch);
+    if (node->numents)
+	(void) fprintf (stderr, " -> %u entries", node->numents);
+    (void) putc ('\n', stderr);
+    for (k = 0;  k < node->numents;  k++)
 	{
-	if (indexp->numents == 0  &&  indexp->pu.fp != NULL)
+	for (j = depth;  --j >= 0;  )
+	    (void) putc (' ', stderr);
+	if (list[node->firstent + k].stripl)
 	    {
-	    for (j = depth;  --j >= 0;  )
-		(void) putc (' ', stderr);
-	    if (i >= ' '  &&  i <= '~')
-		(void) putc (i, stderr);
-	    else
-		(void) fprintf (stderr, "0x%x", i);
-	    (void) putc ('\n', stderr);
-	    dumpindex (indexp->pu.fp, depth + 1);
+	    (void) ichartostr (stripbuf, list[node->firstent + k].strip,
+	      sizeof stripbuf, 1);
+	    (void) fprintf (stderr, "     entry %d (-%s,%s)\n",
+	      (int) (node->firstent + k),
+	      stripbuf,
+	      list[node->firstent + k].affl
+		? ichartosstr (list[node->firstent + k].affix, 1) : "-");
+	    }
+	else
+	    (void) fprintf (stderr, "     entry %d (%s)\n",
+	      (int) (node->firstent + k),
+	      ichartosstr (list[node->firstent + k].affix, 1));
+	}
+    for (i = 0;  i < node->nchildren;  i++)
+	dumpindex (&flagindex[node->firstchild + i], flagindex, list,
+	  depth + 1);
+    }
+#endif
+
+/* n is length of s */
+struct dent * lookup (s, dotree)
+    register ichar_t *		s;
+    int				dotree;
+    {
+    unsigned int		check;
+    unsigned int		index;
+    unsigned int		key;
+    unsigned char		schar[INPUTWORDLEN + MAXAFFIXLEN];
+
+    schar[0] = '\0';			/* Filled in by sameword */
+    if (bloomfilter != NULL  ||  mphtbl != NULL)
+	mphkey (s, &key, &check);
+    if (bloomfilter != NULL
+      &&  !bloomtest (bloomfilter, hashheader.nbloomblocks, key, check))
+	index = NOENTRY;		/* Certainly not in the dictionary */
+    else if (mphtbl != NULL)
+	index = mphlookup (s, schar, key, check);
+    else if (hashbuckets != NULL)
+	index = bucketlookup (s, schar, hash (s, hashheader.nbuckets),
+	  hashfprint (s));
+    else
+	index = chainlookup (s, schar, hash (s, hashsize), hashfprint (s));
+    if (index != NOENTRY)
+	return loaddent (index);
+    else if (dotree)
+	return treelookup (s);
+    else
+	return NULL;
+    }
+
+/*
+** Look up a batch of uppercase words, as lookup() would.  Looking a
+** word up is a short chain of dependent memory references (filter
+** block, index slot, entry, string), and doing words one at a time
+** leaves the processor waiting on each cache miss in turn.  Here each
+** pass takes every word in the batch one step down its chain and
+** prefetches the next reference, so the misses of different words
+** overlap; the last pass finds the entries, by then mostly in cache.
+** Results[i] gets what lookup (words[i], dotree) would return.  If
+** results is NULL, the lookups are not finished; the index entries
+** they need are just brought into the cache.
+*/
+void lookupbatch (words, nwords, results, dotree)
+    ichar_t **			words;	/* Words to look up */
+    int				nwords;	/* Number of words */
+    struct dent **		results; /* Where to put entries, or NULL */
+    int				dotree;	/* NZ to try the personal dict too */
+    {
+    struct batchprobe		probes[LOOKUPBATCH];
+    register struct batchprobe *
+				pp;
+    register struct hashbucket *
+				bp;
+    register int		i;
+    int				n;
+    unsigned int		index;
+    register int		slot;
+    struct dent *		dp;
+    unsigned char		schar[INPUTWORDLEN + MAXAFFIXLEN];
+
+    for (  ;  nwords > 0;  words += n, nwords -= n)
+	{
+	n = nwords < LOOKUPBATCH ? nwords : LOOKUPBATCH;
+	/*
+	** Pass 1:  compute the keys the filter and the perfect hash
+	** need, and fetch each word's block of the filter.
+	*/
+	if (bloomfilter != NULL  ||  mphtbl != NULL)
+	    {
+	    for (i = 0, pp = probes;  i < n;  i++, pp++)
+		{
+		mphkey (words[i], &pp->key, &pp->check);
+		if (bloomfilter != NULL)
+		    PREFETCH (&bloomfilter[(pp->key % hashheader.nbloomblocks)
+		      * BLOOMBLOCKWORDS]);
+		}
 	    }
-	else if (indexp->numents)
+	/*
+	** Pass 2:  drop words the filter rules out, and fetch the first
+	** level of the index for the rest.  Hashing is put off until
+	** here because the filter usually rejects most misspellings.
+	*/
+	for (i = 0, pp = probes;  i < n;  i++, pp++)
 	    {
-	    for (j = depth;  --j >= 0;  )
-		(void) putc (' ', stderr);
-	    if (i >= ' '  &&  i <= '~')
-		(void) putc (i, stderr);
+	    pp->ent = NOENTRY;
+	    if (bloomfilter != NULL
+	      &&  !bloomtest (bloomfilter, hashheader.nbloomblocks,
+		pp->key, pp->check))
+		pp->index = NOENTRY;
+	    else if (mphtbl != NULL)
+		{
+		pp->index = pp->check % hashheader.nmphdisps;
+		PREFETCH (&mphdisp[pp->index]);
+		}
+	    else if (hashbuckets != NULL)
+		{
+		pp->index = hash (words[i], hashheader.nbuckets);
+		PREFETCH (&hashbuckets[pp->index]);
+		pp->fprint = hashfprint (words[i]);
+		}
 	    else
-		(void) fprintf (stderr, "0x%x", i);
-	    (void) fprintf (stderr, " -> %d entries\n", indexp->numents);
-	    for (k = 0;  k < indexp->numents;  k++)
 		{
-		for (j = depth;  --j >= 0;  )
-		    (void) putc (' ', stderr);
-		if (indexp->pu.ent[k].stripl)
+		pp->index = hash (words[i], hashsize);
+		PREFETCH (&hashents[pp->index]);
+		pp->fprint = hashfprint (words[i]);
+		}
+	    }
+	/*
+	** Pass 3:  fetch the perfect-hash slot, the entry with a
+	** matching fingerprint, or the string of the first entry in the
+	** chain.
+	*/
+	for (i = 0, pp = probes;  i < n;  i++, pp++)
+	    {
+	    if (pp->index == NOENTRY)
+		continue;
+	    else if (mphtbl != NULL)
+		{
+		pp->index = mphslot (pp->key, mphdisp[pp->index],
+		  hashheader.nmphslots);
+		PREFETCH (&mphtbl[pp->index]);
+		}
+	    else if (hashbuckets != NULL)
+		{
+		bp = &hashbuckets[pp->index];
+		for (slot = 0;  slot < BUCKETSLOTS;  slot++)
 		    {
-		    (void) ichartostr (stripbuf, indexp->pu.ent[k].strip,
-		      sizeof stripbuf, 1);
-		    (void) fprintf (stderr, "     entry %d (-%s,%s)\n",
-		      &indexp->pu.ent[k] - sflaglist,
-		      stripbuf,
-		      indexp->pu.ent[k].affl
-			? ichartosstr (indexp->pu.ent[k].affix, 1) : "-");
+		    if (bp->fprint[slot] == pp->fprint
+		      ||  bp->fprint[slot] == 0)
+			break;
 		    }
-		else
-		    (void) fprintf (stderr, "     entry %d (%s)\n",
-		      &indexp->pu.ent[k] - sflaglist,
-		      ichartosstr (indexp->pu.ent[k].affix, 1));
+		if (slot < BUCKETSLOTS  &&  bp->fprint[slot] != 0)
+		    {
+		    pp->ent = bp->ent[slot];
+		    PREFETCH (&hashents[pp->ent]);
+		    }
+		}
+	    else if (hashents[pp->index].word != NOWORD)
+		{
+		pp->ent = pp->index;
+		PREFETCH (&hashstrings[hashents[pp->ent].word]);
 		}
 	    }
+	/*
+	** Pass 4:  fetch the entry a perfect-hash slot names, or the
+	** string of the entry a bucket named.
+	*/
+	for (i = 0, pp = probes;  i < n;  i++, pp++)
+	    {
+	    if (pp->index == NOENTRY)
+		continue;
+	    if (mphtbl != NULL)
+		{
+		if (mphtbl[pp->index].check == pp->check)
+		    {
+		    pp->ent = mphtbl[pp->index].ent;
+		    PREFETCH (&hashents[pp->ent]);
+		    }
+		}
+	    else if (hashbuckets != NULL  &&  pp->ent != NOENTRY)
+		PREFETCH (&hashstrings[hashents[pp->ent].word]);
+	    if (pp->ent != NOENTRY)
+		PREFETCH (&hashdentp[pp->ent]);
+	    }
+	/*
+	** Pass 5:  fetch the string a perfect-hash entry points to.
+	*/
+	if (mphtbl != NULL)
+	    {
+	    for (i = 0, pp = probes;  i < n;  i++, pp++)
+		{
+		if (pp->ent != NOENTRY)
+		    PREFETCH (&hashstrings[hashents[pp->ent].word]);
+		}
+	    }
+	/*
+	** Pass 6:  finish each lookup the usual way.
+	*/
+	for (i = 0, pp = probes;  results != NULL  &&  i < n;  i++, pp++)
+	    {
+	    schar[0] = '\0';
+	    if (pp->index == NOENTRY)
+		index = NOENTRY;
+	    else if (mphtbl != NULL)
+		index = (pp->ent != NOENTRY
+		  &&  sameword (pp->ent, words[i], schar))
+		  ? pp->ent : NOENTRY;
+	    else if (hashbuckets != NULL)
+		index = bucketlookup (words[i], schar, pp->index, pp->fprint);
+	    else
+		index = chainlookup (words[i], schar, pp->index, pp->fprint);
+	    if (index != NOENTRY)
+		dp = loaddent (index);
+	    else if (dotree)
+		dp = treelookup (words[i]);
+	    else
+		dp = NULL;
+	    if (results != NULL)
+		results[i] = dp;
+	    }
+	if (results != NULL)
+	    results += n;
 	}
     }
-#endif
 
-/* n is length of s */
-struct dent * lookup (s, dotree)
-    register ichar_t *		s;
-    int				dotree;
+/*
+** Find a word in the main hash table by following its collision chain.
+** Returns the index of the word's entry in hashents, or NOENTRY.
+*/
+static unsigned int chainlookup (s, schar, index, fprint)
+    ichar_t *			s;	/* Word to look up */
+    unsigned char *		schar;	/* Same word, as a string */
+    unsigned int		index;	/* Word's home slot, from hash() */
+    register unsigned int	fprint;	/* Word's fingerprint */
     {
-    register struct dent *	dp;
-    register unsigned char *	s1;
-    unsigned char		schar[INPUTWORDLEN + MAXAFFIXLEN];
+    register struct hashdent *	hdp;
 
-    dp = &hashtbl[hash (s, hashsize)];
-    if (ichartostr (schar, s, sizeof schar, 1))
-	(void) fprintf (stderr, WORD_TOO_LONG (schar));
-    for (  ;  dp != NULL;  dp = dp->next)
+    for (  ;  index != NOENTRY;  index = hdp->next)
 	{
-	/* quick strcmp, but only for equality */
-	s1 = dp->word;
-	if (s1  &&  s1[0] == schar[0]
-	  &&  strcmp ((char *) s1 + 1, (char *) schar + 1) == 0)
-	    return dp;
-	while (dp->flagfield & MOREVARIANTS)	/* Skip variations */
-	    dp = dp->next;
+	hdp = &hashents[index];
+	if (hdp->word != NOWORD  &&  hdp->fprint == fprint
+	  &&  sameword (index, s, schar))
+	    return index;
+	while (hentmask (hdp)->flagfield & MOREVARIANTS) /* Skip variations */
+	    hdp = &hashents[hdp->next];
 	}
-    if (dotree)
+    return NOENTRY;
+    }
+
+/*
+** Find a word in the main hash table by way of the bucketed index.
+** Only entries whose fingerprint matches have their strings compared.
+** Returns the index of the word's entry in hashents, or NOENTRY.
+*/
+static unsigned int bucketlookup (s, schar, bucketno, fprint)
+    ichar_t *			s;	/* Word to look up */
+    unsigned char *		schar;	/* Same word, as a string */
+    unsigned int		bucketno; /* Word's bucket, from hash() */
+    register unsigned int	fprint;	/* Word's fingerprint */
+    {
+    register struct hashbucket *
+				bp;
+    unsigned int		probes;
+    register int		slot;
+
+    for (probes = hashheader.nbuckets;  probes > 0;  probes--)
+	{
+	bp = &hashbuckets[bucketno];
+	for (slot = 0;  slot < BUCKETSLOTS;  slot++)
+	    {
+	    if (bp->fprint[slot] == fprint)
+		{
+		if (sameword (bp->ent[slot], s, schar))
+		    return bp->ent[slot];
+		}
+	    else if (bp->fprint[slot] == 0)
+		return NOENTRY;
+	    }
+	if (++bucketno >= hashheader.nbuckets)
+	    bucketno = 0;
+	}
+    return NOENTRY;
+    }
+
+/*
+** Find a word in the main hash table by way of the perfect hash.  The
+** word can only be in one slot, so this costs a single probe.  Returns
+** the index of the word's entry in hashents, or NOENTRY.
+*/
+static unsigned int mphlookup (s, schar, key, check)
+    ichar_t *			s;	/* Word to look up */
+    unsigned char *		schar;	/* Same word, as a string */
+    unsigned int		key;	/* Word's key from mphkey */
+    unsigned int		check;	/* Word's check value from mphkey */
+    {
+    register struct mphent *	mp;
+
+    mp = &mphtbl[mphslot (key, mphdisp[check % hashheader.nmphdisps],
+      hashheader.nmphslots)];
+    if (mp->check == check  &&  sameword (mp->ent, s, schar))
+	return mp->ent;
+    return NOENTRY;
+    }
+
+/*
+** See if the word in a hash-file entry is the one being looked up.
+** Unpacked words are compared with the ichar_t string directly.  If
+** the hash file's words are packed, the word is converted to a string
+** (in schar, which is empty until then) and packed too, and compared
+** in that form; this is only called once a fingerprint or check value
+** has matched, so the conversion is done only if it is likely to be
+** needed.
+*/
+static int sameword (index, s, schar)
+    unsigned int		index;	/* Index of entry in hashents */
+    ichar_t *			s;	/* Word being looked up */
+    unsigned char *		schar;	/* Same word as a string, or "" */
+    {
+
+    if (!hashheader.packedwords)
+	return icharstrcmp (s, &hashstrings[hashents[index].word]) == 0;
+    if (schar[0] == '\0')
 	{
-	dp = treelookup (s);
+	if (ichartostr (schar, s, INPUTWORDLEN + MAXAFFIXLEN, 1))
+	    DIAG ((stderr, WORD_TOO_LONG (schar)));
+	packword (schar, schar);
+	}
+    return strcmp ((char *) &hashstrings[hashents[index].word],
+      (char *) schar) == 0;
+    }
+
+/*
+** Find an uppercase word in the full-form table.  Returns its first
+** hit, with the number of hits in *nhitsp, or NULL if the affix rules
+** don't derive the word from anything in the dictionary.
+*/
+struct fullhit * fullformlookup (s, nhitsp)
+    ichar_t *			s;	/* Word to look up */
+    unsigned int *		nhitsp;	/* Where to put number of hits */
+    {
+    register struct fullform *	fp;
+    register unsigned int	fprint;	/* Word's fingerprint */
+    unsigned int		slot;
+
+    fprint = hashfprint (s);
+    for (slot = hash (s, hashheader.nfullslots);  ;  )
+	{
+	fp = &fullforms[slot];
+	if (fp->word == NOWORD)
+	    break;
+	if (fp->fprint == fprint
+	  &&  icharstrcmp (s, &fullstrings[fp->word]) == 0)
+	    {
+	    *nhitsp = fp->nhits;
+	    return &fullhits[fp->firsthit];
+	    }
+	if (++slot >= hashheader.nfullslots)
+	    slot = 0;
+	}
+    *nhitsp = 0;
+    return NULL;
+    }
+
+/*
+** Return the usable version of a hash-file entry, filling it (and all
+** of its capitalization variants) in if this is the first time it has
+** been looked up.  Once filled in, the entry belongs to the rest of
+** ispell, which may modify it (e.g., when a personal-dictionary word
+** has a different capitalization), so we never touch it again.  The
+** copies are handed out in order from blocks of DENTPOOLSIZE, so the
+** entries in use sit together in as few pages as possible.  Each thread
+** (see THREADLOCAL) has a pool of its own, and an entry is recorded in
+** hashdentp only when it is complete;  if two threads load the same
+** entry at once, each gets a good copy and one is simply forgotten.  Packed
+** words are unpacked into storage of their own.  If memory runs out,
+** ispell exits;  libispell sets nomemory and returns NULL.
+*/
+struct dent * loaddent (index)
+    unsigned int		index;	/* Index of entry in hashents */
+    {
+    register struct dent *	dp;
+    register struct hashdent *	hdp;
+    register struct hashmask *	mp;
+    struct dent *		first;
+    unsigned int		firstindex;
+    unsigned char		word[INPUTWORDLEN + MAXAFFIXLEN];
+    static THREADLOCAL struct dent *
+				pool = NULL;	/* Unused entries */
+    static THREADLOCAL int	poolleft = 0;	/* No. left in pool */
+
+    if ((dp = PUBLISHED (hashdentp[index])) != NULL)
 	return dp;
+    first = NULL;
+    firstindex = index;
+    for (dp = NULL;  ;  )
+	{
+	if (poolleft == 0)
+	    {
+	    pool =
+	      (struct dent *) malloc (DENTPOOLSIZE * sizeof (struct dent));
+	    if (pool == NULL)
+		{
+		DIAG ((stderr, LOOKUP_C_NO_HASH_SPACE,
+		  MAYBE_CR (stderr)));
+#ifdef LIBISPELL
+		nomemory = 1;
+		return NULL;
+#else /* LIBISPELL */
+		exit (1);
+#endif /* LIBISPELL */
+		}
+	    poolleft = DENTPOOLSIZE;
+	    }
+	if (dp == NULL)
+	    first = pool;
+	else
+	    dp->next = pool;
+	dp = pool++;
+	poolleft--;
+	hdp = &hashents[index];
+	mp = hentmask (hdp);
+	(void) BCOPY ((char *) mp->mask, (char *) dp->mask, sizeof dp->mask);
+#ifdef FULLMASKSET
+	dp->flags = mp->flags;
+#endif
+	if (hdp->word == NOWORD)
+	    dp->word = NULL;
+	else if (!hashheader.packedwords)
+	    dp->word = &hashstrings[hdp->word];
+	else
+	    {
+	    unpackword (word, &hashstrings[hdp->word]);
+	    dp->word = (unsigned char *)
+	      mymalloc ((unsigned int) strlen ((char *) word) + 1);
+	    if (dp->word == NULL)
+		{
+		DIAG ((stderr, LOOKUP_C_NO_HASH_SPACE,
+		  MAYBE_CR (stderr)));
+#ifdef LIBISPELL
+		nomemory = 1;
+		return NULL;
+#else /* LIBISPELL */
+		exit (1);
+#endif /* LIBISPELL */
+		}
+	    (void) strcpy ((char *) dp->word, (char *) word);
+	    }
+	dp->fprint = hdp->fprint;
+	dp->next = NULL;		/* Lookup() searches the chains */
+	if (dp != first)
+	    hashdentp[index] = dp;
+	if ((dp->flagfield & MOREVARIANTS) == 0)
+	    break;
+	index = hdp->next;
 	}
-    else
-	return NULL;
+    PUBLISH (hashdentp[firstindex], first); /* Only now is it complete */
+    return first;
     }
@@ -149,6 +149,8 @@ int		strtoichar P ((ichar_t * out, unsigned char * in, int outlen,
 		  int canonical));
 int		ichartostr P ((unsigned char * out, const ichar_t * in,
 		  int outlen, int canonical));
+int		icharstrcmp P ((const ichar_t * in,
+		  const unsigned char * str));
 ichar_t *	strtosichar P ((unsigned char * in, int canonical));
 unsigned char *	ichartosstr P ((const ichar_t * in, int canonical));
 char *		printichar P ((int in));
@@ -204,7 +206,7 @@ int makedent (lbuf, lbuflen, d)
     if (strtoichar (ibuf, lbuf, INPUTWORDLEN * sizeof (ichar_t), 1)
       ||  ichartostr (lbuf, ibuf, lbuflen, 1))
 	{
-	(void) fprintf (stderr, WORD_TOO_LONG ((char *) lbuf));
+	DIAG ((stderr, WORD_TOO_LONG ((char *) lbuf)));
 	return (-1);
 	}
     /*
@@ -218,8 +220,8 @@ int makedent (lbuf, lbuflen, d)
 	    if (!isboundarych (*ip)
 	      ||  ip == ibuf  ||  ip[1] == 0)
 		{
-		(void) fprintf (stderr, MAKEDENT_C_BAD_WORD_CHAR,
-		  MAYBE_CR (stderr), (char *) lbuf, MAYBE_CR (stderr));
+		DIAG ((stderr, MAKEDENT_C_BAD_WORD_CHAR,
+		  MAYBE_CR (stderr), (char *) lbuf, MAYBE_CR (stderr)));
 		return -1;
 		}
 	    }
@@ -233,15 +235,15 @@ int makedent (lbuf, lbuflen, d)
 
     if (len > INPUTWORDLEN - 1)
 	{
-	(void) fprintf (stderr, WORD_TOO_LONG ((char *) lbuf));
+	DIAG ((stderr, WORD_TOO_LONG ((char *) lbuf)));
 	return (-1);
 	}
 
     d->word = mymalloc ((unsigned) len + 1);
     if (d->word == NULL)
 	{
-	(void) fprintf (stderr, MAKEDENT_C_NO_WORD_SPACE,
-			MAYBE_CR (stderr), (char *) lbuf, MAYBE_CR (stderr));
+	DIAG ((stderr, MAKEDENT_C_NO_WORD_SPACE,
+			MAYBE_CR (stderr), (char *) lbuf, MAYBE_CR (stderr)));
 	return -1;
 	}
 
@@ -258,8 +260,8 @@ int makedent (lbuf, lbuflen, d)
 	if (bit >= 0  &&  bit <= LARGESTFLAG)
 	    SETMASKBIT (d->mask, bit);
 	else if (!aflag)
-	    (void) fprintf (stderr, BAD_FLAG,
-	      MAYBE_CR (stderr), (unsigned char) *p, MAYBE_CR (stderr));
+	    DIAG ((stderr, BAD_FLAG,
+	      MAYBE_CR (stderr), (unsigned char) *p, MAYBE_CR (stderr)));
 	p++;
 	if (*p == hashheader.flagmarker)
 	    p++;		/* Handle old-format dictionaries too */
@@ -335,8 +337,8 @@ int addvheader (dp)
     tdent = (struct dent *) mymalloc (sizeof (struct dent));
     if (tdent == NULL)
 	{
-	(void) fprintf (stderr, MAKEDENT_C_NO_WORD_SPACE,
-	  MAYBE_CR (stderr), (char *) dp->word, MAYBE_CR (stderr));
+	DIAG ((stderr, MAKEDENT_C_NO_WORD_SPACE,
+	  MAYBE_CR (stderr), (char *) dp->word, MAYBE_CR (stderr)));
 	return -1;
 	}
     *tdent = *dp;
@@ -349,8 +351,8 @@ int addvheader (dp)
 	  mymalloc ((unsigned int) strlen ((char *) tdent->word) + 1);
 	if (tdent->word == NULL)
 	    {
-	    (void) fprintf (stderr, MAKEDENT_C_NO_WORD_SPACE,
-	      MAYBE_CR (stderr), (char *) dp->word, MAYBE_CR (stderr));
+	    DIAG ((stderr, MAKEDENT_C_NO_WORD_SPACE,
+	      MAYBE_CR (stderr), (char *) dp->word, MAYBE_CR (stderr)));
 	    myfree ((char *) tdent);
 	    return -1;
 	    }
@@ -469,8 +471,8 @@ int combinecaps (hdrp, newp)
 	tdent = (struct dent *) mymalloc (sizeof (struct dent));
 	if (tdent == NULL)
 	    {
-	    (void) fprintf (stderr, MAKEDENT_C_NO_WORD_SPACE,
-	      MAYBE_CR (stderr), (char *) newp->word, MAYBE_CR (stderr));
+	    DIAG ((stderr, MAKEDENT_C_NO_WORD_SPACE,
+	      MAYBE_CR (stderr), (char *) newp->word, MAYBE_CR (stderr)));
 	    return -1;
 	    }
 	*tdent = *newp;
@@ -719,7 +721,7 @@ void toutent (toutfile, hent, onlykeep)
 
     cent = hent;
     if (strtoichar (wbuf, cent->word, INPUTWORDLEN, 1))
-	(void) fprintf (stderr, WORD_TOO_LONG ((char *) cent->word));
+	DIAG ((stderr, WORD_TOO_LONG ((char *) cent->word)));
     for (  ;  ;  )
 	{
 	if (!onlykeep  ||  (cent->flagfield & KEEP))
@@ -976,43 +978,84 @@ int ichartostr (out, in, outlen, canonical)
     }
 
 /*
- * Convert a string to an ichar_t *, storing the result in a static area.
+ * Compare an ichar_t string with a string in canonical form, without
+ * converting either.  Returns zero if the string is what ichartostr
+ * would make of the ichar_t string, and nonzero otherwise.
+ */
+int icharstrcmp (in, str)
+    register const ichar_t *
+			in;		/* String to compare */
+    register const unsigned char *
+			str;		/* Canonical string to compare with */
+    {
+    register unsigned int
+			ch;		/* Next character to compare */
+    register unsigned char *
+			scharp;		/* Pointer into a string char */
+
+    while ((ch = *in++) != '\0')
+	{
+	if (ch < SET_SIZE)
+	    {
+	    if (*str++ != ch)
+		return 1;
+	    }
+	else
+	    {
+	    for (scharp = hashheader.stringchars[ch - SET_SIZE];
+	      *scharp != '\0';
+	      )
+		{
+		if (*str++ != *scharp++)
+		    return 1;
+		}
+	    }
+	}
+    return *str != '\0';
+    }
+
+/*
+ * Convert a string to an ichar_t *, storing the result in the current
+ * checker context.
  */
 ichar_t * strtosichar (in, canonical)
     unsigned char *	in;		/* String to convert */
     int			canonical;	/* NZ if input is in canonical form */
     {
-    static ichar_t	out[STRTOSICHAR_SIZE / sizeof (ichar_t)];
+    ichar_t *		out;
 
-    if (strtoichar (out, in, sizeof out, canonical))
-	(void) fprintf (stderr, WORD_TOO_LONG ((char *) in));
+    out = curctx->c_sichar;
+    if (strtoichar (out, in, sizeof curctx->c_sichar, canonical))
+	DIAG ((stderr, WORD_TOO_LONG ((char *) in)));
     return out;
     }
 
 /*
- * Convert an ichar_t * to a string, storing the result in a static area.
+ * Convert an ichar_t * to a string, storing the result in the current
+ * checker context.
  */
 unsigned char * ichartosstr (in, canonical)
     const ichar_t *	in;		/* Internal string to convert */
     int			canonical;	/* NZ for canonical conversion */
     {
-    static unsigned char
-			out[ICHARTOSSTR_SIZE];
+    unsigned char *	out;
 
-    if (ichartostr (out, in, sizeof out, canonical))
-	(void) fprintf (stderr, WORD_TOO_LONG (out));
+    out = curctx->c_sstr;
+    if (ichartostr (out, in, sizeof curctx->c_sstr, canonical))
+	DIAG ((stderr, WORD_TOO_LONG (out)));
     return out;
     }
 
 /*
  * Convert a single ichar to a printable string, storing the result in
- * a static area.
+ * the current checker context.
  */
 char * printichar (in)
     int			in;
     {
-    static char		out[MAXSTRINGCHARLEN + 1];
+    char *		out;
 
+    out = curctx->c_printichar;
     if (in < SET_SIZE)
 	{
 	out[0] = (char) in;
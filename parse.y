@@ -138,6 +138,17 @@ static char Rcs_Id[] =
 #include "proto.h"
 #include "msgs.h"
 
+/*
+ * Conditions of an affix rule as they are parsed, with one entry per
+ * character.  They are converted to the compact form kept in a struct
+ * flagent when the rule is complete.
+ */
+struct fullconds
+    {
+    short		numconds;		/* Number of char conditions */
+    char		conds[SET_SIZE + MAXSTRINGCHARS]; /* Adj. char conds */
+    };
+
 %}
 
 %union
@@ -152,6 +163,7 @@ static char Rcs_Id[] =
     unsigned char *	string;		/* String */
     ichar_t *		istr;		/* Internal string */
     struct flagent *	entry;		/* Flag entry */
+    struct fullconds *	conds;		/* Uncompacted affix conditions */
     }
 
 %{
@@ -176,6 +188,16 @@ static int	sufcmp P ((struct flagent * flag1, struct flagent * flag2));
 				/* Compare suffix flags for qsort */
 static int	precmp P ((struct flagent * flag1, struct flagent * flag2));
 				/* Compare prefix flags for qsort */
+static int	copyaffix P ((ichar_t * dest, ichar_t * src));
+				/* Save an affix string in a flag entry */
+static struct flagent * newflagent P ((struct fullconds * fc));
+				/* Make a flag entry for an affix rule */
+static void	compactconds P ((struct flagent * ent,
+		  struct fullconds * fc));
+				/* Put conditions in compact form */
+static void	reclassconds P ((struct flagent * ents, int nents,
+		  int nclasses, int * classrep));
+				/* Convert conditions to new char classes */
 static int	addstringchar P ((unsigned char * str, int lower, int upper));
 				/* Add a string character to the table */
 static int	stringcharcmp P ((unsigned char * a, unsigned char * b));
@@ -275,8 +297,8 @@ static int		ungrablen;	/* Size of ungrab area */
 %type <simple> on_or_off
 %type <simple> rules
 %type <entry> affix_rule
-%type <entry> cond_or_null
-%type <entry> conditions
+%type <conds> cond_or_null
+%type <conds> conditions
 %type <istr> ichar_string
 %%
 file		:	headers tables
@@ -1124,123 +1146,40 @@ rules		:	affix_rule
 
 affix_rule	:	cond_or_null '>' ichar_string
 			    {
-			    int		i;
-
-			    $1->stripl = 0;
-			    $1->strip = NULL;
-			    $1->affl = icharlen ($3);
-			    $1->affix = $3;
-			    upcase ($3);
-			    /*
-			     * As a special optimization (and a
-			     * concession to those who prefer the syntax
-			     * that way), convert any single condition
-			     * that accepts all characters into no
-			     * condition at all.
-			     */
-			    if ($1->numconds == 1)
-				{
-				for (i = SET_SIZE + hashheader.nstrchars;
-				  --i >= 0;
-				  )
-				    {
-				    if (($1->conds[i] & 1) == 0)
-					break;
-				    }
-				if (i < 0)
-				    $1->numconds = 0;
-				}
-			    $$ = $1;
+			    $$ = newflagent ($1);
+			    $$->stripl = 0;
+			    $$->strip[0] = 0;
+			    $$->affl = copyaffix ($$->affix, $3);
 			    }
 		|	cond_or_null '>' '-' ichar_string ',' ichar_string
 			    {
-			    int		    i;
-
-			    $1->stripl = icharlen ($4);
-			    $1->strip = $4;
-			    upcase ($4);
-			    $1->affl = icharlen ($6);
-			    $1->affix = $6;
-			    upcase ($6);
-			    /*
-			     * Convert the syntax ". > -xxx,yyy" into
-			     * " > -xxx,yyy", as in the code just above.
-			     */
-			    if ($1->numconds == 1)
-				{
-				for (i = SET_SIZE + hashheader.nstrchars;
-				  --i >= 0;
-				  )
-				    {
-				    if (($1->conds[i] & 1) == 0)
-					break;
-				    }
-				if (i < 0)
-				    $1->numconds = 0;
-				}
-			    $$ = $1;
+			    $$ = newflagent ($1);
+			    $$->stripl = copyaffix ($$->strip, $4);
+			    $$->affl = copyaffix ($$->affix, $6);
 			    }
 		|	cond_or_null '>' '-' ichar_string ',' '-'
 			    {
-			    int		    i;
-
-			    $1->stripl = icharlen ($4);
-			    $1->strip = $4;
-			    upcase ($4);
-			    $1->affl = 0;
-			    $1->affix = NULL;
-			    /*
-			     * Convert the syntax ". > -xxx," into
-			     * " > -xxx,", as in the code just above.
-			     */
-			    if ($1->numconds == 1)
-				{
-				for (i = SET_SIZE + hashheader.nstrchars;
-				  --i >= 0;
-				  )
-				    {
-				    if (($1->conds[i] & 1) == 0)
-					break;
-				    }
-				if (i < 0)
-				    $1->numconds = 0;
-				}
-			    $$ = $1;
+			    $$ = newflagent ($1);
+			    $$->stripl = copyaffix ($$->strip, $4);
+			    $$->affl = 0;
+			    $$->affix[0] = 0;
 			    }
 		|	cond_or_null '>' '-' ',' '-'
 			    {
-			    int		    i;
-
-			    $1->stripl = 0;
-			    $1->strip = NULL;
-			    $1->affl = 0;
-			    $1->affix = NULL;
-			    /*
-			     * Convert the syntax ". > -,-" into
-			     * " > -,-", as in the code just above.
-			     */
-			    if ($1->numconds == 1)
-				{
-				for (i = SET_SIZE + hashheader.nstrchars;
-				  --i >= 0;
-				  )
-				    {
-				    if (($1->conds[i] & 1) == 0)
-					break;
-				    }
-				if (i < 0)
-				    $1->numconds = 0;
-				}
-			    $$ = $1;
+			    $$ = newflagent ($1);
+			    $$->stripl = 0;
+			    $$->strip[0] = 0;
+			    $$->affl = 0;
+			    $$->affix[0] = 0;
 			    }
 		;
 
 cond_or_null	:	/* Empty */
 			    {
-			    struct flagent *	ent;
+			    struct fullconds *	ent;
 
-			    ent = (struct flagent *)
-			      malloc (sizeof (struct flagent));
+			    ent = (struct fullconds *)
+			      malloc (sizeof (struct fullconds));
 			    if (ent == NULL)
 				{
 				yyerror (PARSE_Y_NO_SPACE);
@@ -1256,11 +1195,11 @@ cond_or_null	:	/* Empty */
 
 conditions	:	char_set
 			    {
-			    struct flagent *	ent;
+			    struct fullconds *	ent;
 			    int			i;
 
-			    ent = (struct flagent *)
-			      malloc (sizeof (struct flagent));
+			    ent = (struct fullconds *)
+			      malloc (sizeof (struct fullconds));
 			    if (ent == NULL)
 				{
 				yyerror (PARSE_Y_NO_SPACE);
@@ -1776,6 +1715,7 @@ void yyinit ()
 	hashheader.lowerchars[i] = 0;
 	hashheader.upperchars[i] = 0;
 	hashheader.boundarychars[i] = 0;
+	hashheader.condclass[i] = 0;
 	/*
 	 * The default sort order is a big value so that there is room
 	 * to insert "underneath" it.  In this way, special characters
@@ -1797,6 +1737,7 @@ void yyinit ()
     hashheader.compoundflag = COMPOUND_NEVER; /* Dflt is report missing blks */
     hashheader.defhardflag = 0; /* Default is to try hard only if failures */
     hashheader.nstrchars = 0;	/* No string characters to start with */
+    hashheader.ncondclasses = 0; /* No affix conditions seen yet */
     hashheader.flagmarker = '/'; /* Default flag marker is slash */
     hashheader.compoundmin = 3;	/* Dflt is at least 3 chars in cmpnd parts */
     hashheader.compoundbit = -1; /* Dflt is no compound bit */
@@ -1874,6 +1815,149 @@ static int precmp (flag1, flag2)	/* Compare prefix flags for qsort */
 	return icharcmp (flag1->affix, flag2->affix);
     }
 
+/*
+ * Copy a strip or affix string into a flag entry, converting it to
+ * uppercase and releasing the original.  Returns the string's length.
+ */
+static int copyaffix (dest, src)
+    ichar_t *			dest;	/* Where to put the string */
+    ichar_t *			src;	/* Malloc'ed string to be saved */
+    {
+    int				len;	/* Length of the string */
+
+    upcase (src);
+    len = icharlen (src);
+    if (len > MAXAFFIXLEN)
+	{
+	yyerror (PARSE_Y_LONG_AFFIX);
+	len = MAXAFFIXLEN;
+	src[len] = 0;
+	}
+    (void) icharcpy (dest, src);
+    free ((char *) src);
+    return len;
+    }
+
+/*
+ * Make a flag entry for an affix rule, given its parsed conditions,
+ * which are released.  The strip and affix strings are left for the
+ * caller to fill in.
+ */
+static struct flagent * newflagent (fc)
+    struct fullconds *		fc;	/* Conditions for the rule */
+    {
+    struct flagent *		ent;	/* New flag entry */
+    int				i;
+
+    ent = (struct flagent *) calloc (1, sizeof (struct flagent));
+    if (ent == NULL)
+	{
+	yyerror (PARSE_Y_NO_SPACE);
+	exit (1);
+	}
+    /*
+     * As a special optimization (and a concession to those who
+     * prefer the syntax that way), convert any single condition that
+     * accepts all characters into no condition at all.  Thus, for
+     * example, ". > -xxx,yyy" becomes " > -xxx,yyy".
+     */
+    if (fc->numconds == 1)
+	{
+	for (i = SET_SIZE + hashheader.nstrchars;  --i >= 0;  )
+	    {
+	    if ((fc->conds[i] & 1) == 0)
+		break;
+	    }
+	if (i < 0)
+	    fc->numconds = 0;
+	}
+    ent->numconds = fc->numconds;
+    compactconds (ent, fc);
+    free ((char *) fc);
+    return ent;
+    }
+
+/*
+ * Store a rule's conditions in a flag entry in compact form.  Each
+ * character is assigned to a class (hashheader.condclass), and the
+ * entry holds only one conds element per class.  Two characters share
+ * a class if every rule seen so far treats them identically.  A new
+ * rule may thus split existing classes, in which case the conditions
+ * of all the entries built so far are rearranged to match.  Classes
+ * are numbered in order of their lowest character, so a rule that
+ * splits nothing leaves the numbering untouched.
+ */
+static void compactconds (ent, fc)
+    struct flagent *		ent;	/* Entry to receive the conditions */
+    struct fullconds *		fc;	/* Conditions, one per character */
+    {
+    int				ch;	/* Character being classified */
+    int				class;	/* Class number being tested */
+    int				classrep[MAXCONDCLASSES];
+					/* Lowest character in each class */
+    unsigned char		newclass[SET_SIZE + MAXSTRINGCHARS];
+					/* New class of each character */
+    int				nclasses; /* Number of classes found */
+
+    nclasses = 0;
+    for (ch = 0;  ch < SET_SIZE + MAXSTRINGCHARS;  ch++)
+	{
+	for (class = 0;  class < nclasses;  class++)
+	    {
+	    if (condclassof (classrep[class]) == condclassof (ch)
+	      &&  fc->conds[classrep[class]] == fc->conds[ch])
+		break;
+	    }
+	if (class >= nclasses)
+	    {
+	    if (nclasses >= MAXCONDCLASSES)
+		{
+		yyerror (PARSE_Y_MANY_CLASSES);
+		exit (1);
+		}
+	    classrep[nclasses++] = ch;
+	    }
+	newclass[ch] = class;
+	}
+    if (nclasses != (int) hashheader.ncondclasses)
+	{
+	reclassconds (curents, centnum, nclasses, classrep);
+	if (tblsize != 0)
+	    reclassconds (table, tblnum, nclasses, classrep);
+	reclassconds (pflaglist, numpflags, nclasses, classrep);
+	reclassconds (sflaglist, numsflags, nclasses, classrep);
+	(void) bcopy ((char *) newclass, (char *) hashheader.condclass,
+	  sizeof hashheader.condclass);
+	hashheader.ncondclasses = nclasses;
+	}
+    (void) bzero (ent->conds, sizeof ent->conds);
+    for (class = 0;  class < nclasses;  class++)
+	ent->conds[class] = fc->conds[classrep[class]];
+    }
+
+/*
+ * Rearrange the conditions of a list of flag entries to match a new
+ * set of character classes, each of which is part of an old class.
+ */
+static void reclassconds (ents, nents, nclasses, classrep)
+    struct flagent *		ents;	/* Entries to rearrange */
+    int				nents;	/* Number of entries */
+    int				nclasses; /* Number of new classes */
+    int *			classrep; /* A character in each new class */
+    {
+    int				class;	/* Class being copied */
+    char			newconds[MAXCONDCLASSES];
+					/* Rearranged conditions */
+
+    for (  ;  --nents >= 0;  ents++)
+	{
+	(void) bzero (newconds, sizeof newconds);
+	for (class = 0;  class < nclasses;  class++)
+	    newconds[class] = ents->conds[condclassof (classrep[class])];
+	(void) bcopy (newconds, ents->conds, sizeof newconds);
+	}
+    }
+
 /* 
  * Add a string character to the table, inserting it in order and
  * updating the table of duplicate string characters.
@@ -2016,13 +2100,19 @@ static void entdump (flagp)		/* Dump one flag entry */
     register struct flagent *	flagp;	/* Flag entry to dump */
     {
     register int		cond;	/* Condition number */
+    int				ch;	/* Character number */
+    unsigned char		conds[SET_SIZE + MAXSTRINGCHARS];
+					/* Conditions, by character */
+
+    for (ch = 0;  ch < SET_SIZE + MAXSTRINGCHARS;  ch++)
+	conds[ch] = flagp->conds[condclassof (ch)];
 
     (void) fprintf (stderr, "flag %s%c:\t",
       (flagp->flagflags & FF_CROSSPRODUCT) ? "*" : "",
       BITTOCHAR (flagp->flagbit));
     for (cond = 0;  cond < flagp->numconds;  cond++)
 	{
-	setdump (flagp->conds, 1 << cond);
+	setdump (conds, 1 << cond);
 	if (cond < flagp->numconds - 1)
 	    (void) putc (' ', stderr);
 	}
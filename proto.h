@@ -146,16 +146,40 @@ extern int	findfiletype P ((char * name, int searchnames,
 		  int * deformatter));
 extern void	flagpr P ((ichar_t * word, int preflag, int prestrip,
 		  int preadd, int sufflag, int sufadd));
+extern void	freeckctx P ((struct checkctx * ctx));
+extern struct fullhit *
+		fullformlookup P ((ichar_t * word, unsigned int * nhitsp));
 extern void	givehelp P ((int interactive));
 extern int	good P ((ichar_t * word, int ignoreflagbits, int allhits,
 		  int pfxopts, int sfxopts));
+extern void	goodcacheenter P ((ichar_t * word, int verdict,
+		  struct dent * root));
+extern int	goodcachelookup P ((ichar_t * word, struct dent ** rootp));
+extern void	goodcachestats P ((FILE * statfile));
+extern int	goodent P ((ichar_t * word, ichar_t * nword, int len,
+		  struct dent * dp, int ignoreflagbits, int allhits,
+		  int pfxopts, int sfxopts));
 extern int	hash P ((ichar_t * word, int hashtablesize));
+extern unsigned int hashfprint P ((ichar_t * word));
+extern void	mphkey P ((ichar_t * word, unsigned int * keyp,
+		  unsigned int * checkp));
+extern unsigned int mphslot P ((unsigned int key, unsigned int disp,
+		  unsigned int nslots));
+extern void	bloomadd P ((unsigned int * filter, unsigned int nblocks,
+		  unsigned int key, unsigned int check));
+extern int	bloomtest P ((unsigned int * filter, unsigned int nblocks,
+		  unsigned int key, unsigned int check));
+extern void	packinit P ((void));
+extern void	packword P ((unsigned char * out, unsigned char * in));
+extern void	unpackword P ((unsigned char * out, unsigned char * in));
 #ifndef ICHAR_IS_CHAR
 extern int	icharcmp P ((ichar_t * s1, ichar_t * s2));
 extern ichar_t * icharcpy P ((ichar_t * out, ichar_t * in));
 extern int	icharlen P ((ichar_t * str));
 extern int	icharncmp P ((ichar_t * s1, ichar_t * s2, int n));
 #endif /* ICHAR_IS_CHAR */
+extern int	icharstrcmp P ((const ichar_t * in,
+		  const unsigned char * str));
 extern int	ichartostr P ((unsigned char * out, const ichar_t * in,
 		  int outlen, int canonical));
 extern unsigned char *
@@ -167,17 +191,23 @@ extern int	ins_root_cap P ((ichar_t * word, ichar_t * pattern,
 		  struct flagent * sufent));
 extern void	inverse P ((void));
 extern int	linit P ((void));
+extern struct dent * loaddent P ((unsigned int index));
 extern struct dent * lookup P ((ichar_t * word, int dotree));
+extern void	lookupbatch P ((ichar_t ** words, int nwords,
+		  struct dent ** results, int dotree));
 extern void	lowcase P ((ichar_t * string));
 extern int	makedent P ((unsigned char * lbuf, int lbuflen,
 		  struct dent * d));
 extern void	makepossibilities P ((ichar_t * word));
 extern int	inpossibilities P ((unsigned char * ctok));
+extern int	needinposs P ((ichar_t * word));
 extern void	imove P ((int row, int col));
+extern struct checkctx * newckctx P ((void));
 extern void	normal P ((void));
 extern char *	printichar P ((int in));
 extern int	init_keyword_table P ((char * rawtags, char * envvar,
 		  char * deftags, int ignorecase, struct kwtable * keywords));
+extern struct checkctx * setckctx P ((struct checkctx * ctx));
 #ifdef USESH
 extern int	shellescape P ((char * buf));
 extern void	shescape P ((char * buf));
@@ -200,6 +230,8 @@ extern void	treeinit P ((char * persdict, char * LibDict));
 extern void	treeinsert P ((unsigned char * word, int wordlen, int keep));
 extern struct dent * treelookup P ((ichar_t * word));
 extern void	treeoutput P ((void));
+extern void	treewalk P ((void (*func) (struct dent * ent, VOID * arg),
+		  VOID * arg));
 extern void	upcase P ((ichar_t * string));
 extern long	whatcap P ((ichar_t * word));
 extern char *	xgets P ((char * string, int size, FILE * stream));
@@ -128,15 +128,22 @@ static char Rcs_Id[] =
 
 void		chk_aff P ((ichar_t * word, ichar_t * ucword, int len,
 		  int ignoreflagbits, int allhits, int pfxopts, int sfxopts));
+static void	chk_fullform P ((ichar_t * word, ichar_t * ucword, int len));
 static void	pfx_list_chk P ((ichar_t * word, ichar_t * ucword,
-		  int len, int optflags, int sfxopts, struct flagptr * ind,
+		  int len, int optflags, int sfxopts, struct affixnode * node,
 		  int ignoreflagbits, int allhits));
 static void	chk_suf P ((ichar_t * word, ichar_t * ucword, int len,
 		  int optflags, struct flagent * pfxent, int ignoreflagbits,
 		  int allhits));
 static void	suf_list_chk P ((ichar_t * word, ichar_t * ucword, int len,
-		  struct flagptr * ind, int optflags, struct flagent * pfxent,
-		  int ignoreflagbits, int allhits));
+		  struct affixnode * node, int optflags,
+		  struct flagent * pfxent, int ignoreflagbits, int allhits));
+static struct affixnode *
+		affixchild P ((struct affixnode * flagindex,
+		  struct affixnode * node, ichar_t ch));
+static struct dent *
+		rootlookup P ((ichar_t * root));
+#ifndef LIBISPELL
 int		expand_pre P ((unsigned char * croot, ichar_t * rootword,
 		  MASKTYPE mask[], int option, unsigned char * extra));
 static void	gen_pre_expansion P ((ichar_t * rootword,
@@ -155,6 +162,7 @@ static void	forcelc P ((ichar_t * dst, int len));
 static char *	flags_str P ((MASKTYPE flags));
 static int	output_expansions P ((struct exp_table * exptable, int option,
 		  unsigned char * croot, unsigned char * extra));
+#endif /* LIBISPELL */
 
 /* Check possible affixes */
 void chk_aff (word, ucword, len, ignoreflagbits, allhits, pfxopts, sfxopts)
@@ -167,42 +175,77 @@ void chk_aff (word, ucword, len, ignoreflagbits, allhits, pfxopts, sfxopts)
     int			sfxopts;	/* Options to apply to suffixes */
     {
     register ichar_t *	cp;		/* Pointer to char to index on */
-    struct flagptr *	ind;		/* Flag index table to test */
+    struct affixnode *	node;		/* Trie node for prefix so far */
 
-    pfx_list_chk (word, ucword, len, pfxopts, sfxopts, &pflagindex[0],
-      ignoreflagbits, allhits);
+    /*
+    ** A full-form table lists every hit the walk below could find in
+    ** the main dictionary, so it will do unless we are after something
+    ** special, or the personal dictionary may hold roots of its own.
+    */
+    if (fullforms != NULL  &&  !treeaffixed  &&  !ignoreflagbits
+      &&  !allhits  &&  !cflag  &&  pfxopts == 0  &&  sfxopts == 0)
+	{
+	chk_fullform (word, ucword, len);
+	return;
+	}
+    curctx->c_nroots = 0;
     cp = ucword;
-    ind = &pflagindex[*cp++];
-    while (ind->numents == 0  &&  ind->pu.fp != NULL)
+    for (node = pflagindex;  node != NULL;  )
 	{
-	if (*cp == 0)
-	    return;
-	if (ind->pu.fp[0].numents)
+	if (node->numents)
 	    {
-	    pfx_list_chk (word, ucword, len, pfxopts, sfxopts, &ind->pu.fp[0],
+	    pfx_list_chk (word, ucword, len, pfxopts, sfxopts, node,
 	      ignoreflagbits, allhits);
 	    if (numhits  &&  !allhits  &&  !cflag  &&  !ignoreflagbits)
 		return;
 	    }
-	ind = &ind->pu.fp[*cp++];
+	if (*cp == 0)
+	    break;
+	node = affixchild (pflagindex, node, *cp++);
 	}
-    pfx_list_chk (word, ucword, len, pfxopts, sfxopts, ind, ignoreflagbits,
-      allhits);
-    if (numhits  &&  !allhits  &&  !cflag  &&  !ignoreflagbits)
-	return;
     chk_suf (word, ucword, len, sfxopts, (struct flagent *) NULL,
       ignoreflagbits, allhits);
     }
 
+/*
+** Check a word's affixes by way of the full-form table.  The hits are
+** tried in the order chk_aff would find them, and the first one with
+** acceptable capitalization is kept.
+*/
+static void chk_fullform (word, ucword, len)
+    ichar_t *		word;		/* Word to be checked */
+    ichar_t *		ucword;		/* Upper-case-only copy of word */
+    int			len;		/* The length of word/ucword */
+    {
+    register struct fullhit *
+			fhp;		/* Hit being tried */
+    unsigned int	nhits;		/* Number of hits left to try */
+
+    for (fhp = fullformlookup (ucword, &nhits);  nhits > 0;  fhp++, nhits--)
+	{
+	hits[0].dictent = loaddent (fhp->ent);
+	if (hits[0].dictent == NULL)
+	    return;		/* Out of memory (libispell only) */
+	hits[0].prefix =
+	  fhp->prefix == NOAFFIX ? NULL : &pflaglist[fhp->prefix];
+	hits[0].suffix =
+	  fhp->suffix == NOAFFIX ? NULL : &sflaglist[fhp->suffix];
+	numhits = 1;
+	if (cap_ok (word, &hits[0], len))
+	    return;
+	numhits = 0;
+	}
+    }
+
 /* Check some prefix flags */
-static void pfx_list_chk (word, ucword, len, optflags, sfxopts, ind,
+static void pfx_list_chk (word, ucword, len, optflags, sfxopts, node,
   ignoreflagbits, allhits)
     ichar_t *		word;		/* Word to be checked */
     ichar_t *		ucword;		/* Upper-case-only word */
     int			len;		/* The length of ucword */
     int			optflags;	/* Options to apply */
     int			sfxopts;	/* Options to apply to suffixes */
-    struct flagptr *	ind;		/* Flag index table */
+    struct affixnode *	node;		/* Trie node matching prefix */
     int			ignoreflagbits;	/* Ignore whether affix is legal */
     int			allhits;	/* Keep going after first hit */
     {
@@ -217,7 +260,7 @@ static void pfx_list_chk (word, ucword, len, optflags, sfxopts, ind,
     ichar_t		tword[INPUTWORDLEN + 4 * MAXAFFIXLEN + 4]; /* Tmp cpy */
     ichar_t		tword2[sizeof tword]; /* 2nd copy for ins_root_cap */
 
-    for (flent = ind->pu.ent, entcount = ind->numents;
+    for (flent = &pflaglist[node->firstent], entcount = node->numents;
       entcount > 0;
       flent++, entcount--)
 	{
@@ -236,12 +279,11 @@ static void pfx_list_chk (word, ucword, len, optflags, sfxopts, ind,
 	  &&  ((flent->flagflags ^ optflags) & FF_COMPOUNDONLY) != 0)
 	    continue;
 	/*
-	 * See if the prefix matches.
+	 * The trie only leads here if the prefix matches, but it
+	 * mustn't be the whole word.
 	 */
 	tlen = len - flent->affl;
 	if (tlen > 0
-	  &&  (flent->affl == 0
-	    ||  icharncmp (flent->affix, ucword, flent->affl) == 0)
 	  &&  tlen + flent->stripl >= flent->numconds)
 	    {
 	    /*
@@ -254,7 +296,7 @@ static void pfx_list_chk (word, ucword, len, optflags, sfxopts, ind,
 	    cp = tword;
 	    for (cond = 0;  cond < flent->numconds;  cond++)
 		{
-		if ((flent->conds[*cp++] & (1 << cond)) == 0)
+		if ((flent->conds[condclassof (*cp++)] & (1 << cond)) == 0)
 		    break;
 		}
 	    if (cond >= flent->numconds)
@@ -264,12 +306,15 @@ static void pfx_list_chk (word, ucword, len, optflags, sfxopts, ind,
 		 * dictionary.
 		 */
 		tlen += flent->stripl;
+#ifndef LIBISPELL
 		if (cflag)
 		    flagpr (tword, BITTOCHAR (flent->flagbit), flent->stripl,
 		      flent->affl, -1, 0);
-		else if (ignoreflagbits)
+		else
+#endif /* LIBISPELL */
+		if (ignoreflagbits)
 		    {
-		    if ((dent = lookup (tword, 1)) != NULL)
+		    if ((dent = rootlookup (tword)) != NULL)
 			{
 			cp = tword2;
 			if (flent->affl)
@@ -292,7 +337,7 @@ static void pfx_list_chk (word, ucword, len, optflags, sfxopts, ind,
 			  dent, flent, (struct flagent *) NULL);
 			}
 		    }
-		else if ((dent = lookup (tword, 1)) != NULL
+		else if ((dent = rootlookup (tword)) != NULL
 		  &&  TSTMASKBIT (dent->mask, flent->flagbit))
 		    {
 		    if (numhits < MAX_HITS)
@@ -332,35 +377,62 @@ static void chk_suf (word, ucword, len, optflags, pfxent, ignoreflagbits,
     int			allhits;	/* Keep going after first hit */
     {
     register ichar_t *	cp;		/* Pointer to char to index on */
-    struct flagptr *	ind;		/* Flag index table to test */
+    struct affixnode *	node;		/* Trie node for suffix so far */
 
-    suf_list_chk (word, ucword, len, &sflagindex[0], optflags, pfxent,
-      ignoreflagbits, allhits);
-    cp = ucword + len - 1;
-    ind = &sflagindex[*cp];
-    while (ind->numents == 0  &&  ind->pu.fp != NULL)
+    cp = ucword + len;
+    for (node = sflagindex;  node != NULL;  )
 	{
-	if (cp == ucword)
-	    return;
-	if (ind->pu.fp[0].numents)
+	if (node->numents)
 	    {
-	    suf_list_chk (word, ucword, len, &ind->pu.fp[0],
-	      optflags, pfxent, ignoreflagbits, allhits);
+	    suf_list_chk (word, ucword, len, node, optflags, pfxent,
+	      ignoreflagbits, allhits);
 	    if (numhits != 0  &&  !allhits  &&  !cflag  &&  !ignoreflagbits)
 		return;
 	    }
-	ind = &ind->pu.fp[*--cp];
+	if (cp == ucword)
+	    break;
+	node = affixchild (sflagindex, node, *--cp);
 	}
-    suf_list_chk (word, ucword, len, ind, optflags, pfxent,
-      ignoreflagbits, allhits);
     }
-    
-static void suf_list_chk (word, ucword, len, ind, optflags, pfxent,
+
+/*
+** Find the child of an affix trie node that is reached by a given
+** character, or NULL if there is none.  Children are sorted by
+** character, so this is a binary search.
+*/
+static struct affixnode * affixchild (flagindex, node, ch)
+    struct affixnode *	flagindex;	/* Trie containing node */
+    struct affixnode *	node;		/* Node whose child is wanted */
+    register ichar_t	ch;		/* Character leading to child */
+    {
+    register struct affixnode *
+			child;		/* Child being tested */
+    register struct affixnode *
+			lo;		/* First candidate child */
+    register struct affixnode *
+			hi;		/* Last candidate child, plus one */
+
+    lo = &flagindex[node->firstchild];
+    hi = lo + node->nchildren;
+    while (lo < hi)
+	{
+	child = lo + (hi - lo) / 2;
+	if (child->ch == ch)
+	    return child;
+	else if (child->ch < ch)
+	    lo = child + 1;
+	else
+	    hi = child;
+	}
+    return NULL;
+    }
+
+static void suf_list_chk (word, ucword, len, node, optflags, pfxent,
   ignoreflagbits, allhits)
     ichar_t *		word;		/* Word to be checked */
     ichar_t *		ucword;		/* Upper-case-only word */
     int			len;		/* The length of ucword */
-    struct flagptr *	ind;		/* Flag index table */
+    struct affixnode *	node;		/* Trie node matching suffix */
     int			optflags;	/* Affix option flags */
     struct flagent *	pfxent;		/* Prefix flag entry if crossonly */
     int			ignoreflagbits;	/* Ignore whether affix is legal */
@@ -378,7 +450,7 @@ static void suf_list_chk (word, ucword, len, ind, optflags, pfxent,
     ichar_t		tword2[sizeof tword]; /* 2nd copy for ins_root_cap */
 
     (void) icharcpy (tword, ucword);
-    for (flent = ind->pu.ent, entcount = ind->numents;
+    for (flent = &sflaglist[node->firstent], entcount = node->numents;
       entcount > 0;
       flent++, entcount--)
 	{
@@ -400,12 +472,11 @@ static void suf_list_chk (word, ucword, len, ind, optflags, pfxent,
 	  &&  ((flent->flagflags ^ optflags) & FF_COMPOUNDONLY) != 0)
 	    continue;
 	/*
-	 * See if the suffix matches.
+	 * The trie only leads here if the suffix matches, but it
+	 * mustn't be the whole word.
 	 */
 	tlen = len - flent->affl;
 	if (tlen > 0
-	  &&  (flent->affl == 0
-	    ||  icharcmp (flent->affix, ucword + tlen) == 0)
 	  &&  tlen + flent->stripl >= flent->numconds)
 	    {
 	    /*
@@ -424,7 +495,7 @@ static void suf_list_chk (word, ucword, len, ind, optflags, pfxent,
 		*cp = '\0';
 	    for (cond = flent->numconds;  --cond >= 0;  )
 		{
-		if ((flent->conds[*--cp] & (1 << cond)) == 0)
+		if ((flent->conds[condclassof (*--cp)] & (1 << cond)) == 0)
 		    break;
 		}
 	    if (cond < 0)
@@ -433,6 +504,7 @@ static void suf_list_chk (word, ucword, len, ind, optflags, pfxent,
 		 * The conditions match.  See if the word is in the
 		 * dictionary.
 		 */
+#ifndef LIBISPELL
 		if (cflag)
 		    {
 		    if (optflags & FF_CROSSPRODUCT)
@@ -443,9 +515,11 @@ static void suf_list_chk (word, ucword, len, ind, optflags, pfxent,
 			flagpr (tword, -1, 0, 0,
 			  BITTOCHAR (flent->flagbit), flent->affl);
 		    }
-		else if (ignoreflagbits)
+		else
+#endif /* LIBISPELL */
+		if (ignoreflagbits)
 		    {
-		    if ((dent = lookup (tword, 1)) != NULL)
+		    if ((dent = rootlookup (tword)) != NULL)
 			{
 			cp = tword2;
 			if ((optflags & FF_CROSSPRODUCT)
@@ -484,7 +558,7 @@ static void suf_list_chk (word, ucword, len, ind, optflags, pfxent,
 			  dent, pfxent, flent);
 			}
 		    }
-		else if ((dent = lookup (tword, 1)) != NULL
+		else if ((dent = rootlookup (tword)) != NULL
 		  &&  TSTMASKBIT (dent->mask, flent->flagbit)
 		  &&  ((optflags & FF_CROSSPRODUCT) == 0
 		    || TSTMASKBIT (dent->mask, pfxent->flagbit)))
@@ -508,6 +582,39 @@ static void suf_list_chk (word, ucword, len, ind, optflags, pfxent,
 	}
     }
 
+/*
+ * Look up a candidate root found by stripping an affix.  Several affix
+ * entries often strip a word down to the same root (e.g., flags that
+ * share a suffix but have different conditions, or a root reached both
+ * with and without a cross-product prefix), so the roots looked up
+ * during one chk_aff call are remembered, and each is looked up in the
+ * dictionary and personal dictionary only once.
+ */
+static struct dent * rootlookup (root)
+    ichar_t *		root;		/* Root to look up, in uppercase */
+    {
+    register struct rootmemo *
+			rp;
+    register int	i;
+    int			len;		/* Length of root */
+
+    len = icharlen (root);
+    for (i = curctx->c_nroots, rp = curctx->c_roots;  --i >= 0;  rp++)
+	{
+	if (rp->r_len == len  &&  icharcmp (rp->r_word, root) == 0)
+	    return rp->r_dent;
+	}
+    if (curctx->c_nroots >= MAXROOTMEMO
+      ||  len >= INPUTWORDLEN + MAXAFFIXLEN)
+	return lookup (root, 1);
+    rp = &curctx->c_roots[curctx->c_nroots++];
+    rp->r_len = len;
+    (void) icharcpy (rp->r_word, root);
+    rp->r_dent = lookup (root, 1);
+    return rp->r_dent;
+    }
+
+#ifndef LIBISPELL
 /*
  * Expand a dictionary prefix entry
  */
@@ -560,7 +667,8 @@ static void gen_pre_expansion (rootword, flent, mask, exptable)
     tlen += flent->affl;
     for (cond = 0, nextc = rootword;  cond < flent->numconds;  cond++)
 	{
-	if ((flent->conds[mytoupper (*nextc++)] & (1 << cond)) == 0)
+	if ((flent->conds[condclassof (mytoupper (*nextc++))] & (1 << cond))
+	  == 0)
 	    return;
 	}
     /*
@@ -708,7 +816,8 @@ static void gen_suf_expansion (rootword, flent, exptable, existing_flags)
     wascapitalized = myupper (rootword[0]);
     for (nextc = rootword + tlen;  --cond >= 0;  )
 	{
-	if ((flent->conds[mytoupper (*--nextc)] & (1 << cond)) == 0)
+	if ((flent->conds[condclassof (mytoupper (*--nextc))] & (1 << cond))
+	  == 0)
 	    return;
 	if (nextc > rootword  &&  myupper (*nextc))
 	    wascapitalized = 0;
@@ -829,3 +938,4 @@ static int output_expansions (exptable, option, croot, extra)
 
     return explength;
     }
+#endif /* LIBISPELL */
@@ -106,6 +106,8 @@ static void	treeload P ((FILE * dictf));
 void		treeinsert P ((unsigned char * word, int wordlen, int keep));
 static struct dent * tinsert P ((struct dent * proto));
 struct dent *	treelookup P ((ichar_t * word));
+void		treewalk P ((void (*func) (struct dent * ent, VOID * arg),
+		  VOID * arg));
 #if SORTPERSONAL != 0
 static int	pdictcmp P ((struct dent ** enta, struct dent **entb));
 #endif /* SORTPERSONAL != 0 */
@@ -120,6 +122,8 @@ static int		cantexpand = 0;	/* NZ if an expansion fails */
 static struct dent *	pershtab;	/* Aux hash table for personal dict */
 static int		pershsize = 0;	/* Space available in aux hash table */
 static int		hcount = 0;	/* Number of items in hash table */
+static unsigned int *	persbloom = NULL; /* Negative-lookup filter for it */
+static unsigned int	persbloomsize;	/* Number of blocks in persbloom */
 
 /*
  * Hash table sizes.  Prime is probably a good idea, though in truth I
@@ -288,8 +292,10 @@ void treeinit (p, LibDict)
 	     */
 	    if (dictf == NULL)
 		{
-		(void) fprintf (stderr, CANT_OPEN, p, MAYBE_CR (stderr));
+		DIAG ((stderr, CANT_OPEN, p, MAYBE_CR (stderr)));
+#ifndef LIBISPELL
 		perror ("");
+#endif /* LIBISPELL */
 		return;
 		}
 	    }
@@ -298,8 +304,8 @@ void treeinit (p, LibDict)
     if (!lflag  &&  !aflag
       &&  access (personaldict, W_OK) < 0  &&  errno != ENOENT)
 	{
-	(void) fprintf (stderr, TREE_C_CANT_UPDATE, personaldict,
-	  MAYBE_CR (stderr));
+	DIAG ((stderr, TREE_C_CANT_UPDATE, personaldict,
+	  MAYBE_CR (stderr)));
 	(void) sleep ((unsigned) 2);
 	}
     }
@@ -343,6 +349,7 @@ void treeinsert (word, wordlen, keep)
     int			keep;
     {
     register unsigned int i;
+    register int	flagword;
     struct dent		wordent;
     register struct dent * dp;
     struct dent *	olddp;
@@ -352,6 +359,12 @@ void treeinsert (word, wordlen, keep)
     ichar_t		nword[INPUTWORDLEN + MAXAFFIXLEN];
     int			isvariant;
 
+    /*
+     * The new word may change verdicts in the word cache, and an
+     * expansion moves the entries that the cache points to.
+     */
+    wcgeneration++;
+
     /*
      * Expand hash table when it is MAXPCT % full.
      */
@@ -372,7 +385,7 @@ void treeinsert (word, wordlen, keep)
 	  (struct dent *) calloc ((unsigned) pershsize, sizeof (struct dent));
 	if (pershtab == NULL)
 	    {
-	    (void) fprintf (stderr, TREE_C_NO_SPACE, MAYBE_CR (stderr));
+	    DIAG ((stderr, TREE_C_NO_SPACE, MAYBE_CR (stderr)));
 	    /*
 	     * Try to continue anyway, since our overflow
 	     * algorithm can handle an overfull (100%+) table,
@@ -381,8 +394,17 @@ void treeinsert (word, wordlen, keep)
 	     * for overflow entries will still work.
 	     */
 	    if (oldhtab == NULL)
-		exit (1);		/* No old table, can't go on */
-	    (void) fprintf (stderr, TREE_C_TRY_ANYWAY, MAYBE_CR (stderr));
+		{
+		/* No old table, can't go on */
+#ifdef LIBISPELL
+		pershsize = oldhsize;
+		nomemory = 1;
+		return;
+#else /* LIBISPELL */
+		exit (1);
+#endif /* LIBISPELL */
+		}
+	    DIAG ((stderr, TREE_C_TRY_ANYWAY, MAYBE_CR (stderr)));
 	    cantexpand = 1;		/* Suppress further messages */
 	    pershsize = oldhsize;	/* Put things back */
 	    pershtab = oldhtab;		/* ... */
@@ -390,6 +412,16 @@ void treeinsert (word, wordlen, keep)
 	    }
 	else
 	    {
+	    /*
+	     * Make a new filter to suit the new size.  If there isn't
+	     * room, we simply do without.
+	     */
+	    if (persbloom != NULL)
+		free ((char *) persbloom);
+	    persbloomsize =
+	      pershsize * BLOOMBITS / (BLOOMBLOCKWORDS * 32) + 1;
+	    persbloom = (unsigned int *)
+	      calloc (persbloomsize * BLOOMBLOCKWORDS, sizeof (unsigned int));
 	    /*
 	     * Re-insert old entries into new table
 	     */
@@ -399,6 +431,8 @@ void treeinsert (word, wordlen, keep)
 		if (dp->flagfield & USED)
 		    {
 		    newdp = tinsert (dp);
+		    if (newdp == NULL)
+			continue;	/* Out of memory;  word is lost */
 		    isvariant = (dp->flagfield & MOREVARIANTS);
 		    dp = dp->next;
 		    while (dp != NULL)
@@ -419,6 +453,8 @@ void treeinsert (word, wordlen, keep)
 			    olddp = dp;
 			    dp = dp->next;
 			    free ((char *) olddp);
+			    if (newdp == NULL)
+				break;	/* Out of memory;  rest are lost */
 			    }
 			}
 		    }
@@ -437,6 +473,17 @@ void treeinsert (word, wordlen, keep)
     if (keep)
 	wordent.flagfield |= KEEP;
     /*
+    ** A word with affix flags can be the root of words that a
+    ** full-form table doesn't know about, so chk_aff must stop using it.
+    */
+    for (flagword = MASKSIZE - 1;  --flagword >= 0;  )
+	{
+	if (wordent.mask[flagword] != 0)
+	    treeaffixed = 1;
+	}
+    if ((wordent.mask[MASKSIZE - 1] & ~ALLFLAGS) != 0)
+	treeaffixed = 1;
+    /*
     ** Now see if word or a variant is already in the table.  We use the
     ** capitalized version so we'll find the header, if any.
     **/
@@ -455,12 +502,21 @@ void treeinsert (word, wordlen, keep)
 	{
 	/* It's new. Insert the word. */
 	dp = tinsert (&wordent);
+	if (dp == NULL)
+	    {
+	    free (wordent.word);
+	    return;
+	    }
 	if (captype (dp->flagfield) == FOLLOWCASE)
 	   (void) addvheader (dp);
 	}
     newwords |= keep;
     }
 
+/*
+ * Add a copy of an entry to the personal hash table.  In libispell,
+ * returns NULL (and sets nomemory) if there's no room;  ispell exits.
+ */
 static struct dent * tinsert (proto)
     struct dent *	proto;		/* Prototype entry to copy */
     {
@@ -468,9 +524,16 @@ static struct dent * tinsert (proto)
     register int	hcode;
     register struct dent * hp;		/* Next trial entry in hash table */
     register struct dent * php;		/* Prev. value of hp, for chaining */
+    unsigned int	key;		/* Filter key for the word */
+    unsigned int	check;		/* Filter check value for the word */
 
     if (strtoichar (iword, proto->word, sizeof iword, 1))
-	(void) fprintf (stderr, WORD_TOO_LONG ((char *) proto->word));
+	DIAG ((stderr, WORD_TOO_LONG ((char *) proto->word)));
+    if (persbloom != NULL)
+	{
+	mphkey (iword, &key, &check);
+	bloomadd (persbloom, persbloomsize, key, check);
+	}
     hcode = hash (iword, pershsize);
     php = NULL;
     hp = &pershtab[hcode];
@@ -484,11 +547,17 @@ static struct dent * tinsert (proto)
 	hp = (struct dent *) calloc (1, sizeof (struct dent));
 	if (hp == NULL)
 	    {
-	    (void) fprintf (stderr, TREE_C_NO_SPACE, MAYBE_CR (stderr));
+	    DIAG ((stderr, TREE_C_NO_SPACE, MAYBE_CR (stderr)));
+#ifdef LIBISPELL
+	    nomemory = 1;
+	    return NULL;
+#else /* LIBISPELL */
 	    exit (1);
+#endif /* LIBISPELL */
 	    }
 	}
     *hp = *proto;
+    hp->fprint = hashfprint (iword);
     if (php != NULL)
 	php->next = hp;
     hp->next = NULL;
@@ -500,16 +569,25 @@ struct dent * treelookup (word)
     {
     register int	hcode;
     register struct dent * hp;
-    char		chword[INPUTWORDLEN + MAXAFFIXLEN];
+    register unsigned int fprint;
+    unsigned int	key;
+    unsigned int	check;
 
     if (pershsize <= 0)
 	return NULL;
-    (void) ichartostr ((unsigned char *) chword, word, sizeof chword, 1);
+    if (persbloom != NULL)
+	{
+	mphkey (word, &key, &check);
+	if (!bloomtest (persbloom, persbloomsize, key, check))
+	    return NULL;
+	}
+    fprint = hashfprint (word);
     hcode = hash (word, pershsize);
     hp = &pershtab[hcode];
     while (hp != NULL  &&  (hp->flagfield & USED))
 	{
-	if (strcmp (chword, (char *) hp->word) == 0)
+	if (hp->fprint == fprint
+	  &&  icharstrcmp (word, (unsigned char *) hp->word) == 0)
 	    break;
 	while (hp->flagfield & MOREVARIANTS)
 	    hp = hp->next;
@@ -521,6 +599,34 @@ struct dent * treelookup (word)
 	return NULL;
     }
 
+/*
+** Call func on every word in the personal dictionary, passing arg
+** along.  A word with several capitalizations is visited only once,
+** at its header entry.
+*/
+void treewalk (func, arg)
+    void		(*func) P ((struct dent * ent, VOID * arg));
+					/* Function to call on each word */
+    VOID *		arg;		/* Argument to pass to func */
+    {
+    register struct dent *	cent;	/* Current entry */
+    register struct dent *	lent;	/* Linked entry */
+    register struct dent *	ehtab;	/* End of pershtab, for fast looping */
+
+    for (cent = pershtab, ehtab = pershtab + pershsize;
+      cent < ehtab;
+      cent++)
+	{
+	for (lent = cent;  lent != NULL;  lent = lent->next)
+	    {
+	    if (lent->flagfield & USED)
+		(*func) (lent, arg);
+	    while (lent->flagfield & MOREVARIANTS)
+		lent = lent->next;
+	    }
+	}
+    }
+
 #if SORTPERSONAL != 0
 /* Comparison routine for sorting the personal dictionary with qsort */
 static int pdictcmp (enta, entb)
@@ -547,13 +653,15 @@ void treeoutput ()
     register struct dent **	sortptr; /* Handy pointer into sortlist */
 #endif
     register struct dent *	ehtab;	/* End of pershtab, for fast looping */
+    register struct dent **	hent;	/* Current main-dictionary entry */
+    struct dent **		ehent;	/* End of hashdentp */
 
     if (newwords == 0)
 	return;
 
     if ((dictf = fopen (personaldict, "w")) == NULL)
 	{
-	(void) fprintf (stderr, CANT_CREATE, personaldict, MAYBE_CR (stderr));
+	DIAG ((stderr, CANT_CREATE, personaldict, MAYBE_CR (stderr)));
 	return;
 	}
 
@@ -579,11 +687,14 @@ void treeoutput ()
 		  lent = lent->next;
 		}
 	    }
-	for (cent = hashtbl, ehtab = hashtbl + hashsize;
-	  cent < ehtab;
-	  cent++)
+	ehent = hashdentp + hashsize + hashheader.nvariants;
+	for (hent = hashdentp;
+	  hent < ehent;
+	  hent++)
 	    {
-	    if ((cent->flagfield & (USED | KEEP)) == (USED | KEEP))
+	    cent = *hent;
+	    if (cent != NULL
+	      &&  (cent->flagfield & (USED | KEEP)) == (USED | KEEP))
 		{
 		/*
 		** We only want to count variant headers
@@ -616,11 +727,14 @@ void treeoutput ()
 		    }
 		}
 	    }
-	for (cent = hashtbl, ehtab = hashtbl + hashsize;
-	  cent < ehtab;
-	  cent++)
+	ehent = hashdentp + hashsize + hashheader.nvariants;
+	for (hent = hashdentp;
+	  hent < ehent;
+	  hent++)
 	    {
-	    if ((cent->flagfield & (USED | KEEP)) == (USED | KEEP))
+	    cent = *hent;
+	    if (cent != NULL
+	      &&  (cent->flagfield & (USED | KEEP)) == (USED | KEEP))
 		{
 		if (captype (cent->flagfield) != FOLLOWCASE
 		  &&  cent->word != NULL)
@@ -650,9 +764,12 @@ void treeoutput ()
 		}
 	    }
 	}
-    for (cent = hashtbl, ehtab = hashtbl + hashsize;  cent < ehtab;  cent++)
+    ehent = hashdentp + hashsize + hashheader.nvariants;
+    for (hent = hashdentp;  hent < ehent;  hent++)
 	{
-	if ((cent->flagfield & (USED | KEEP)) == (USED | KEEP))
+	cent = *hent;
+	if (cent != NULL
+	  &&  (cent->flagfield & (USED | KEEP)) == (USED | KEEP))
 	    {
 	    if (captype (cent->flagfield) != FOLLOWCASE
 	      &&  cent->word != NULL)
@@ -699,13 +816,15 @@ char * do_regex_lookup (expr, whence)
     int		whence;	/* 0 = start at the beg with new regx, else */
 			/* continue from cur point w/ old regex     */
     {
-    static struct dent *    curent;
+    static struct hashdent * curent;
     static int		    curindex;
     static struct dent *    curpersent;
     static int		    curpersindex;
     static REGCTYPE	    cmp_expr = (REGCTYPE) NULL;
     char		    dummy[INPUTWORDLEN + MAXAFFIXLEN];
     ichar_t *		    is;
+    static unsigned char    unpacked[INPUTWORDLEN + MAXAFFIXLEN];
+    unsigned char *	    word;
 
     if (whence == 0)
 	{
@@ -714,21 +833,28 @@ char * do_regex_lookup (expr, whence)
 	expr = ichartosstr (is, 1);
 	REGFREE (cmp_expr);	/* free previous compiled pattern, if any */
         cmp_expr = REGCMP (cmp_expr, expr);
-        curent = hashtbl;
+        curent = hashents;
         curindex = 0;
         curpersent = pershtab;
         curpersindex = 0;
 	}
     
     /* search the dictionary until the word is found or the words run out */
-    for (  ; curindex < hashsize;  curent++, curindex++)
+    for (  ; curindex < hashsize + hashheader.nvariants;  curent++, curindex++)
 	{
-        if (curent->word != NULL
-          &&  REGEX (cmp_expr, (char *) curent->word, dummy) != NULL)
+	if (curent->word == NOWORD)
+	    continue;
+	word = &hashstrings[curent->word];
+	if (hashheader.packedwords)
+	    {
+	    unpackword (unpacked, word);
+	    word = unpacked;
+	    }
+	if (REGEX (cmp_expr, (char *) word, dummy) != NULL)
 	    {
 	    curindex++;
-	    /* Everybody's gotta write a wierd expression once in a while! */
-	    return (char *) curent++->word;
+	    curent++;
+	    return (char *) word;
 	    }
 	}
     /* Try the personal dictionary too */